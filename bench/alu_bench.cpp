@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "bench.h"
+#include "../src/alu.h"
+
+/*
+Times the branchless and table driven flag functions against each other
+over random operands. Each result feeds the next operation the way the
+accumulator and P register do in a run of 6502 arithmetic, so the
+latency of a table lookup counts and not just its throughput.
+*/
+
+namespace {
+	const size_t OPERANDS = 4096;
+
+	struct Branchless {
+		static u8 nz(u8 value) { return alu::branchless::nz(value); }
+		static u8 adc(u8 a, u8 operand, u8 carry) { return alu::branchless::adc(a, operand, carry); }
+		static u8 compare(u8 reg, u8 operand) { return alu::branchless::compare(reg, operand); }
+	};
+
+	struct Table {
+		static u8 nz(u8 value) { return alu::table::nz(value); }
+		static u8 adc(u8 a, u8 operand, u8 carry) { return alu::table::adc(a, operand, carry); }
+		static u8 compare(u8 reg, u8 operand) { return alu::table::compare(reg, operand); }
+	};
+
+	template <typename ALU>
+	double time_adc(const std::vector<u8>& operands) {
+		return bench::measure([&](unsigned long iterations) {
+			u8 a = 0, p = 0;
+			for (unsigned long i = 0; i < iterations; i++) {
+				u8 operand = operands[i % OPERANDS];
+				u8 carry = p & alu::CARRY;
+				p = ALU::adc(a, operand, carry);
+				a = a + operand + carry;
+			}
+			bench::keep(a);
+			bench::keep(p);
+		});
+	}
+
+	template <typename ALU>
+	double time_compare(const std::vector<u8>& operands) {
+		return bench::measure([&](unsigned long iterations) {
+			u8 p = 0;
+			for (unsigned long i = 0; i < iterations; i++)
+				p = ALU::compare(operands[i % OPERANDS] ^ p, operands[(i + 1) % OPERANDS]);
+			bench::keep(p);
+		});
+	}
+
+	template <typename ALU>
+	double time_nz(const std::vector<u8>& operands) {
+		return bench::measure([&](unsigned long iterations) {
+			u8 p = 0;
+			for (unsigned long i = 0; i < iterations; i++) p = ALU::nz(operands[i % OPERANDS] + p);
+			bench::keep(p);
+		});
+	}
+}
+
+int main(int argc, char** argv) {
+	bench::Reporter reporter("alu", argc, argv);
+	alu::init();
+	std::vector<u8> operands(OPERANDS);
+	for (size_t i = 0; i < OPERANDS; i++) operands[i] = rand();
+
+	reporter.add("alu.adc.branchless", time_adc<Branchless>(operands), "ns/op");
+	reporter.add("alu.adc.table", time_adc<Table>(operands), "ns/op");
+	reporter.add("alu.compare.branchless", time_compare<Branchless>(operands), "ns/op");
+	reporter.add("alu.compare.table", time_compare<Table>(operands), "ns/op");
+	reporter.add("alu.nz.branchless", time_nz<Branchless>(operands), "ns/op");
+	reporter.add("alu.nz.table", time_nz<Table>(operands), "ns/op");
+	return reporter.finish();
+}
@@ -0,0 +1,88 @@
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "bench.h"
+#include "../src/apu.h"
+
+/*
+Runs the APU through a minute of busy emulated music (every channel
+playing, notes changing every frame) and reports what an emulated second
+costs on the host.
+*/
+
+namespace {
+	const int SECONDS = 60;
+	const int FRAMES_PER_SECOND = 60;
+	const unsigned int FRAME_CYCLES = 29781;
+
+	// Roughly what an average instruction takes, run() is called once per
+	// instruction by the NES.
+	const unsigned int INSTRUCTION_CYCLES = 3;
+
+	// Pulse timer values of a C major scale around middle C
+	const u16 SCALE[8] = { 0x1AB, 0x17C, 0x153, 0x140, 0x11C, 0x0FD, 0x0E2, 0x0D5 };
+
+	void setup(APU& apu) {
+		apu.writeRegister(0x4015, 0x0F);
+		apu.writeRegister(0x4000, 0xBF);	// 50% duty, constant volume 15
+		apu.writeRegister(0x4004, 0x7A);	// 25% duty, decaying envelope
+		apu.writeRegister(0x4005, 0x00);
+		apu.writeRegister(0x4008, 0xFF);	// Triangle always on
+		apu.writeRegister(0x400C, 0x34);	// Noise, constant volume 4
+		apu.writeRegister(0x400E, 0x03);
+		apu.writeRegister(0x400F, 0xF8);
+	}
+
+	void play(APU& apu, int frame) {
+		u16 note = SCALE[(frame / 8) % 8];
+		apu.writeRegister(0x4002, note & 0xFF);
+		apu.writeRegister(0x4003, 0xF8 | (note >> 8));
+		u16 harmony = SCALE[(frame / 8 + 2) % 8] >> 1;
+		apu.writeRegister(0x4006, harmony & 0xFF);
+		if (frame % 16 == 0) apu.writeRegister(0x4007, 0xF8 | (harmony >> 8));
+		u16 bass = SCALE[(frame / 32) % 8] << 1;
+		apu.writeRegister(0x400A, bass & 0xFF);
+		apu.writeRegister(0x400B, 0xF8 | (bass >> 8));
+		apu.writeRegister(0x4011, (frame * 7) & 0x7F);
+	}
+}
+
+int main(int argc, char** argv) {
+	bench::Reporter reporter("apu", argc, argv);
+	APU apu(NULL);
+	RingBuffer<s16> output(1 << 16);
+	apu.setOutput(&output);
+	apu.getRateControl().setEnabled(false);
+	setup(apu);
+
+	std::vector<s16> samples(output.capacity());
+	double sum_squares = 0.0;
+	unsigned long sample_count = 0;
+	double apu_time = 0.0;
+
+	for (int frame = 0; frame < SECONDS * FRAMES_PER_SECOND; frame++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		play(apu, frame);
+		for (unsigned int cycles = 0; cycles < FRAME_CYCLES; cycles += INSTRUCTION_CYCLES)
+			apu.run(INSTRUCTION_CYCLES);
+		apu.endFrame();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		apu_time += elapsed.count();
+
+		size_t count = output.pop(samples.data(), samples.size());
+		for (size_t i = 0; i < count; i++) sum_squares += static_cast<double>(samples[i]) * samples[i];
+		sample_count += count;
+	}
+
+	double rms = sample_count ? sqrt(sum_squares / sample_count) : 0.0;
+	if (rms < 100.0) {
+		printf("ERROR: APU output is silent!\n");
+		return -1;
+	}
+
+	printf("apu: %lu samples at %uHz, rms %.0f\n", sample_count, apu.getSampleRate(), rms);
+	reporter.add("apu.second", apu_time * 1000.0 / SECONDS, "ms");
+	return reporter.finish();
+}
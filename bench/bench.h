@@ -0,0 +1,98 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*
+Shared helpers for the benchmarks. Every result printed through a
+Reporter is also collected and, when the benchmark was started with
+--json <file>, written out for bench/compare.py to diff two runs.
+*/
+
+namespace bench {
+	struct Result {
+		std::string name;
+		double value;
+		std::string unit;
+		bool lower_is_better;
+	};
+
+	class Reporter {
+	public:
+		Reporter(const char* benchmark, int argc, char** argv) : benchmark(benchmark) {
+			for (int i = 1; i < argc; i++) {
+				if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_file = argv[++i];
+			}
+		}
+
+		void add(const std::string& name, double value, const std::string& unit, bool lower_is_better = true) {
+			printf("%-32s %12.3f %s\n", name.c_str(), value, unit.c_str());
+			results.push_back({ name, value, unit, lower_is_better });
+		}
+
+		// Writes the JSON file if one was asked for, returns the exit code
+		// for main().
+		int finish() {
+			if (json_file.empty()) return 0;
+			FILE* file = fopen(json_file.c_str(), "w");
+			if (!file) {
+				printf("ERROR: Unable to write %s!\n", json_file.c_str());
+				return -1;
+			}
+			fprintf(file, "{\n\t\"benchmark\": \"%s\",\n\t\"results\": [\n", benchmark.c_str());
+			for (size_t i = 0; i < results.size(); i++) {
+				const Result& result = results[i];
+				fprintf(file, "\t\t{ \"name\": \"%s\", \"value\": %.6f, \"unit\": \"%s\", \"lower_is_better\": %s }%s\n",
+					result.name.c_str(), result.value, result.unit.c_str(),
+					result.lower_is_better ? "true" : "false", i + 1 < results.size() ? "," : "");
+			}
+			fprintf(file, "\t]\n}\n");
+			fclose(file);
+			return 0;
+		}
+	private:
+		std::string benchmark;
+		std::string json_file;
+		std::vector<Result> results;
+	};
+
+	// Runs body(iterations) with iterations doubled until a run takes
+	// 50ms, then keeps the fastest of five runs of that size. Returns
+	// nanoseconds per iteration.
+	template <typename Body>
+	double measure(Body body) {
+		typedef std::chrono::steady_clock Clock;
+		const double MIN_SECONDS = 0.05;
+		const int RUNS = 5;
+
+		unsigned long iterations = 1;
+		for (;;) {
+			Clock::time_point start = Clock::now();
+			body(iterations);
+			std::chrono::duration<double> elapsed = Clock::now() - start;
+			if (elapsed.count() >= MIN_SECONDS) break;
+			iterations *= 2;
+		}
+
+		double best = 0.0;
+		for (int run = 0; run < RUNS; run++) {
+			Clock::time_point start = Clock::now();
+			body(iterations);
+			std::chrono::duration<double> elapsed = Clock::now() - start;
+			if (run == 0 || elapsed.count() < best) best = elapsed.count();
+		}
+		return best * 1e9 / iterations;
+	}
+
+	// Keeps the compiler from optimizing away a result
+	template <typename T>
+	void keep(const T& value) {
+		asm volatile("" : : "g"(&value) : "memory");
+	}
+}
+
+#endif // BENCH_H
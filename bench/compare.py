@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""
+Compares two sets of benchmark results written by make bench (directories
+of JSON files, or single files) and exits with 1 if any result got worse
+by more than the threshold.
+
+    bench/compare.py bench-results-old bench-results --threshold 5
+"""
+
+import argparse
+import glob
+import json
+import os
+import sys
+
+
+def load(path):
+    files = sorted(glob.glob(os.path.join(path, "*.json"))) if os.path.isdir(path) else [path]
+    results = {}
+    for name in files:
+        with open(name) as f:
+            for result in json.load(f)["results"]:
+                results[result["name"]] = result
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag benchmark regressions between two runs")
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=5.0, help="allowed slowdown in percent (default 5)")
+    args = parser.parse_args()
+
+    old = load(args.old)
+    new = load(args.new)
+
+    regressions = 0
+    for name in sorted(set(old) | set(new)):
+        if name not in old or name not in new:
+            print("%-32s %s" % (name, "only in new" if name in new else "only in old"))
+            continue
+        before = old[name]["value"]
+        after = new[name]["value"]
+        if before == 0:
+            continue
+        change = (after - before) / before * 100.0
+        # Positive is always worse, whichever way the unit goes
+        worse = change if new[name]["lower_is_better"] else -change
+        flag = ""
+        if worse > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-32s %12.3f -> %12.3f %-10s %+7.1f%%%s" % (name, before, after, new[name]["unit"], change, flag))
+
+    if regressions:
+        print("%d regression(s) over %.1f%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
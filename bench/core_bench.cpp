@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "bench.h"
+#include "../src/cartridge.h"
+#include "../src/memory.h"
+#include "../src/cpu.h"
+#include "../src/nes.h"
+
+/*
+Microbenchmarks for the core hot paths: the CPU interpreter on small
+loops of each opcode group, Memory reads and writes over a few address
+mixes, cartridge reads and whole frames. Everything runs from one
+synthetic mapper 0 ROM with every loop in its own page.
+*/
+
+namespace {
+	const size_t PRG_SIZE = 0x4000;
+	const size_t CHR_SIZE = 0x2000;
+	const size_t ADDRESSES = 4096;
+
+	struct Program {
+		const char* name;
+		std::vector<u8> code;	// Jumps back to its start when done
+	};
+
+	// Each loop sits at $8000 + index * $100, a JSR target at +$80
+	const Program PROGRAMS[] = {
+		{ "load_store", {
+			0xA9, 0x12,			// LDA #$12
+			0x85, 0x10,			// STA $10
+			0xA6, 0x10,			// LDX $10
+			0x8E, 0x00, 0x02,	// STX $0200
+			0xAC, 0x00, 0x02,	// LDY $0200
+			0x94, 0x20,			// STY $20,X
+			0xBD, 0x00, 0x03,	// LDA $0300,X
+			0x99, 0x00, 0x04,	// STA $0400,Y
+		} },
+		{ "arithmetic", {
+			0x69, 0x13,			// ADC #$13
+			0xE5, 0x10,			// SBC $10
+			0x29, 0x7F,			// AND #$7F
+			0x05, 0x11,			// ORA $11
+			0x49, 0x55,			// EOR #$55
+			0xC9, 0x40,			// CMP #$40
+			0xE0, 0x10,			// CPX #$10
+			0xC4, 0x12,			// CPY $12
+		} },
+		{ "branch", {
+			0xA2, 0x10,			// LDX #$10
+			0xCA,				// DEX
+			0xD0, 0xFD,			// BNE -3
+			0x18,				// CLC
+			0x90, 0x00,			// BCC +0
+			0xB0, 0x00,			// BCS +0 (not taken)
+		} },
+		{ "stack_jump", {
+			0x20, 0x80, 0x83,	// JSR $8380
+			0x48,				// PHA
+			0x08,				// PHP
+			0x28,				// PLP
+			0x68,				// PLA
+		} },
+		{ "shift_inc", {
+			0x0A,				// ASL A
+			0x26, 0x10,			// ROL $10
+			0x46, 0x11,			// LSR $11
+			0x6A,				// ROR A
+			0xE6, 0x12,			// INC $12
+			0xCE, 0x00, 0x02,	// DEC $0200
+			0xE8,				// INX
+			0x88,				// DEY
+		} },
+		{ "flags_transfer", {
+			0x18,				// CLC
+			0x38,				// SEC
+			0xB8,				// CLV
+			0xAA,				// TAX
+			0xA8,				// TAY
+			0x8A,				// TXA
+			0x98,				// TYA
+			0xBA,				// TSX
+			0x9A,				// TXS
+			0xD8,				// CLD
+		} },
+	};
+	const int PROGRAM_COUNT = sizeof(PROGRAMS) / sizeof(PROGRAMS[0]);
+
+	std::vector<u8> buildROM() {
+		std::vector<u8> rom(16 + PRG_SIZE + CHR_SIZE, 0xEA);
+		const u8 header[16] = { 'N', 'E', 'S', 0x1A, 1, 1 };
+		for (int i = 0; i < 16; i++) rom[i] = header[i];
+
+		u8* prg = &rom[16];
+		for (int i = 0; i < PROGRAM_COUNT; i++) {
+			u16 start = 0x8000 + i * 0x100;
+			size_t offset = i * 0x100;
+			for (size_t j = 0; j < PROGRAMS[i].code.size(); j++) prg[offset + j] = PROGRAMS[i].code[j];
+			offset += PROGRAMS[i].code.size();
+			prg[offset++] = 0x4C;	// JMP start
+			prg[offset++] = start & 0xFF;
+			prg[offset++] = start >> 8;
+			prg[i * 0x100 + 0x80] = 0x60;	// RTS
+		}
+
+		// Reset and NMI/IRQ vectors, the frame benchmark runs the branch loop
+		u16 reset = 0x8200;
+		prg[0x3FFA] = prg[0x3FFC] = prg[0x3FFE] = reset & 0xFF;
+		prg[0x3FFB] = prg[0x3FFD] = prg[0x3FFF] = reset >> 8;
+		return rom;
+	}
+
+	// Random addresses in [first, last]
+	std::vector<u16> addresses(unsigned int first, unsigned int last) {
+		std::vector<u16> result(ADDRESSES);
+		for (size_t i = 0; i < ADDRESSES; i++) result[i] = first + rand() % (last - first + 1);
+		return result;
+	}
+
+	// Roughly what a game reads: mostly code and data in ROM, the rest RAM
+	// with a few PPU and controller register polls.
+	std::vector<u16> gameReads() {
+		std::vector<u16> result(ADDRESSES);
+		for (size_t i = 0; i < ADDRESSES; i++) {
+			int kind = rand() % 10;
+			if (kind < 6) result[i] = 0x8000 + rand() % 0x8000;
+			else if (kind < 9) result[i] = rand() % 0x0800;
+			else result[i] = rand() % 2 ? 0x2002 : 0x4016;
+		}
+		return result;
+	}
+
+	std::vector<u16> gameWrites() {
+		std::vector<u16> result(ADDRESSES);
+		for (size_t i = 0; i < ADDRESSES; i++) {
+			if (rand() % 10 < 9) result[i] = rand() % 0x0800;
+			else result[i] = 0x2000 + rand() % 8;
+		}
+		return result;
+	}
+
+	void benchReads(bench::Reporter& reporter, const char* name, Memory& memory, const std::vector<u16>& mix) {
+		reporter.add(name, bench::measure([&](unsigned long iterations) {
+			u8 sum = 0;
+			for (unsigned long i = 0; i < iterations; i++) sum += memory.readByte(mix[i & (ADDRESSES - 1)]);
+			bench::keep(sum);
+		}), "ns/access");
+	}
+
+	void benchWrites(bench::Reporter& reporter, const char* name, Memory& memory, const std::vector<u16>& mix) {
+		reporter.add(name, bench::measure([&](unsigned long iterations) {
+			for (unsigned long i = 0; i < iterations; i++) memory.writeByte(i & 0xFF, mix[i & (ADDRESSES - 1)]);
+		}), "ns/access");
+	}
+}
+
+int main(int argc, char** argv) {
+	bench::Reporter reporter("core", argc, argv);
+
+	Cartridge cartridge(buildROM());
+	Memory memory(cartridge);
+	CPU cpu(memory);
+	NES nes(cpu, memory);
+	printf("\n");
+
+	// CPU::execute_opcode through tick(), the way the NES drives it
+	for (int i = 0; i < PROGRAM_COUNT; i++) {
+		cpu.regPC.set(0x8000 + i * 0x100);
+		std::string name = std::string("cpu.") + PROGRAMS[i].name;
+		reporter.add(name, bench::measure([&](unsigned long iterations) {
+			for (unsigned long j = 0; j < iterations; j++) cpu.tick();
+		}), "ns/instr");
+	}
+
+	srand(1);
+	benchReads(reporter, "memory.read.ram", memory, addresses(0x0000, 0x1FFF));
+	benchReads(reporter, "memory.read.rom", memory, addresses(0x8000, 0xFFFF));
+	benchReads(reporter, "memory.read.game", memory, gameReads());
+	benchWrites(reporter, "memory.write.ram", memory, addresses(0x0000, 0x07FF));
+	benchWrites(reporter, "memory.write.game", memory, gameWrites());
+
+	std::vector<u16> rom_addresses = addresses(0x8000, 0xFFFF);
+	reporter.add("cartridge.read.mapper0", bench::measure([&](unsigned long iterations) {
+		u8 sum = 0;
+		for (unsigned long i = 0; i < iterations; i++) sum += cartridge.read(rom_addresses[i & (ADDRESSES - 1)]);
+		bench::keep(sum);
+	}), "ns/read");
+
+	// Patched pages are read through the same page table as the rest
+	Cheat cheat = {0x9000, 0xEA, -1};
+	cartridge.addCheat(cheat);
+	reporter.add("cartridge.read.cheat", bench::measure([&](unsigned long iterations) {
+		u8 sum = 0;
+		for (unsigned long i = 0; i < iterations; i++) sum += cartridge.read(rom_addresses[i & (ADDRESSES - 1)]);
+		bench::keep(sum);
+	}), "ns/read");
+	cartridge.clearCheats();
+
+	// There is no PPU yet, a frame is the CPU and APU for a frame's worth
+	// of cycles plus the palette conversion of the framebuffer.
+	cpu.reset();
+	reporter.add("nes.frame", bench::measure([&](unsigned long iterations) {
+		for (unsigned long i = 0; i < iterations; i++) nes.run_frame();
+	}) / 1000.0, "us/frame");
+	reporter.add("nes.frame.skipped", bench::measure([&](unsigned long iterations) {
+		for (unsigned long i = 0; i < iterations; i++) nes.run_frame(false);
+	}) / 1000.0, "us/frame");
+
+	return reporter.finish();
+}
@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "bench.h"
+#include "../src/framebuffer.h"
+#include "../src/palette.h"
+
+/*
+Compares the scalar palette conversion loop against the AVX2 gather
+kernel over whole frames of random indices.
+*/
+
+namespace {
+	const int FRAMES = 2000;
+	const size_t PIXELS = Framebuffer::WIDTH * Framebuffer::HEIGHT;
+
+	typedef void (Palette::*Kernel)(const u16*, u32*, size_t);
+
+	double run(Palette& palette, Kernel kernel, const std::vector<u16>& indices, std::vector<u32>& pixels) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < FRAMES; i++) (palette.*kernel)(indices.data(), pixels.data(), PIXELS);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+}
+
+int main(int argc, char** argv) {
+	bench::Reporter reporter("palette", argc, argv);
+	Palette palette;
+	std::vector<u16> indices(PIXELS);
+	for (size_t i = 0; i < PIXELS; i++) indices[i] = rand() % Palette::ENTRIES;
+
+	std::vector<u32> scalar(PIXELS), avx2(PIXELS);
+	double scalar_time = run(palette, &Palette::convertScalar, indices, scalar);
+	double avx2_time = run(palette, &Palette::convertAVX2, indices, avx2);
+
+	if (scalar != avx2) {
+		printf("ERROR: AVX2 conversion doesn't match the scalar loop!\n");
+		return -1;
+	}
+
+	reporter.add("palette.scalar", scalar_time * 1e6 / FRAMES, "us/frame");
+	reporter.add("palette.avx2", avx2_time * 1e6 / FRAMES, "us/frame");
+	return reporter.finish();
+}
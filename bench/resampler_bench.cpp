@@ -0,0 +1,76 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "../src/resampler.h"
+
+/*
+Converts a minute of 48kHz audio to 44.1kHz with every quality preset
+and dot product kernel, in frame sized chunks like the recorder, and
+reports output samples per second.
+*/
+
+namespace {
+	const unsigned int INPUT_RATE = 48000;
+	const unsigned int OUTPUT_RATE = 44100;
+	const int SECONDS = 60;
+	const size_t CHUNK = 800;	// About one frame of APU output
+
+	const char* QUALITY_NAMES[3] = { "low", "medium", "high" };
+	const char* KERNEL_NAMES[3] = { "scalar", "sse", "avx2" };
+
+	double run(Resampler& resampler, const std::vector<s16>& input, std::vector<s16>& output) {
+		output.clear();
+		output.reserve(input.size());
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < input.size(); i += CHUNK) {
+			size_t count = input.size() - i < CHUNK ? input.size() - i : CHUNK;
+			resampler.process(&input[i], count, output);
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+}
+
+int main(int argc, char** argv) {
+	bench::Reporter reporter("resampler", argc, argv);
+
+	// A square wave sweep, full of harmonics like the APU's output
+	std::vector<s16> input(INPUT_RATE * SECONDS);
+	double phase = 0.0;
+	for (size_t i = 0; i < input.size(); i++) {
+		phase += (100.0 + 4000.0 * i / input.size()) / INPUT_RATE;
+		input[i] = (phase - floor(phase)) < 0.5 ? 8000 : -8000;
+	}
+
+	for (int quality = 0; quality < 3; quality++) {
+		std::vector<s16> reference;
+		for (int kernel = 0; kernel < 3; kernel++) {
+			Resampler resampler(INPUT_RATE, OUTPUT_RATE, static_cast<ResampleQuality>(quality));
+			if (!resampler.setKernel(static_cast<ResampleKernel>(kernel))) {
+				printf("resample %-6s %-6s: not supported on this host\n", QUALITY_NAMES[quality], KERNEL_NAMES[kernel]);
+				continue;
+			}
+
+			std::vector<s16> output;
+			double time = run(resampler, input, output);
+
+			// Sums are added up in a different order, allow a rounding step
+			if (kernel == 0) reference = output;
+			bool matches = reference.size() == output.size();
+			for (size_t i = 0; matches && i < output.size(); i++) matches = abs(reference[i] - output[i]) <= 1;
+			if (!matches) {
+				printf("ERROR: %s kernel doesn't match the scalar one!\n", KERNEL_NAMES[kernel]);
+				return -1;
+			}
+
+			std::string name = std::string("resample.") + QUALITY_NAMES[quality] + "." + KERNEL_NAMES[kernel];
+			reporter.add(name, output.size() / time / 1e6, "Msamples/s", false);
+		}
+	}
+	return reporter.finish();
+}
@@ -0,0 +1,18 @@
+#include "alu.h"
+
+const alu::NZTable alu::nz_table;
+u8 alu::adc_table[0x20000];
+
+namespace {
+	bool fill_adc_table() {
+		for (unsigned int i = 0; i < 0x20000; i++) alu::adc_table[i] = alu::branchless::adc(i >> 8, i, i >> 16);
+		return true;
+	}
+}
+
+void alu::init() {
+	// A function local static is initialized once, other callers wait
+	// for the first one to finish
+	static const bool filled = fill_adc_table();
+	(void)filled;
+}
@@ -0,0 +1,82 @@
+#ifndef ALU_H
+#define ALU_H
+
+#include "definitions.h"
+
+/*
+Status flags produced by the 6502's arithmetic, returned as the bits
+they take in the P register. Two implementations of the same functions:
+branchless arithmetic, and lookups into tables. The CPU uses the one the
+build picks (make TABLE_ALU=1 defines NES_TABLE_ALU), bench/alu_bench.cpp
+times both on the host.
+
+The NZ table is built by the compiler. The 128 KiB ADC table is only
+filled by init(), which the CPU calls when it uses the tables.
+
+SBC is ADC of the inverted operand and compares are SBC with the carry
+set, so one (carry, A, operand) table serves all three.
+*/
+
+namespace alu {
+	const u8 CARRY = 0x01;
+	const u8 ZERO = 0x02;
+	const u8 OVERFLOW = 0x40;
+	const u8 NEGATIVE = 0x80;
+	const u8 NZ = NEGATIVE | ZERO;
+	const u8 NZC = NEGATIVE | ZERO | CARRY;
+	const u8 NVZC = NEGATIVE | OVERFLOW | ZERO | CARRY;
+
+	namespace branchless {
+		constexpr u8 nz(u8 value) {
+			return (value & NEGATIVE) | (value == 0) << 1;
+		}
+
+		inline u8 adc(u8 a, u8 operand, u8 carry) {
+			unsigned int sum = a + operand + carry;
+			u8 result = sum;
+			return nz(result) | (sum >> 8) | ((a ^ result) & (operand ^ result) & 0x80) >> 1;
+		}
+
+		inline u8 compare(u8 reg, u8 operand) {
+			return nz(reg - operand) | (reg >= operand);
+		}
+	}
+
+	struct NZTable {
+		u8 flags[0x100];
+
+		constexpr NZTable() : flags() {
+			for (int value = 0; value < 0x100; value++) {
+				flags[value] = branchless::nz(value);
+			}
+		}
+	};
+	extern const NZTable nz_table;
+
+	// Fills adc_table on the first call, safe to call from any thread
+	void init();
+
+	extern u8 adc_table[0x20000];	// Indexed by carry << 16 | A << 8 | operand
+
+	namespace table {
+		inline u8 nz(u8 value) {
+			return nz_table.flags[value];
+		}
+
+		inline u8 adc(u8 a, u8 operand, u8 carry) {
+			return adc_table[carry << 16 | a << 8 | operand];
+		}
+
+		inline u8 compare(u8 reg, u8 operand) {
+			return adc_table[1 << 16 | reg << 8 | static_cast<u8>(~operand)] & NZC;
+		}
+	}
+
+#ifdef NES_TABLE_ALU
+	namespace selected = table;
+#else
+	namespace selected = branchless;
+#endif
+}
+
+#endif // ALU_H
@@ -0,0 +1,511 @@
+#include "apu.h"
+#include "coverage.h"
+
+namespace {
+	const double CLOCK_RATE = 1789773.0;
+	const unsigned int DEFAULT_SAMPLE_RATE = 48000;
+
+	const u8 LENGTH_TABLE[32] = {
+		10, 254, 20, 2, 40, 4, 80, 6, 160, 8, 60, 10, 14, 12, 26, 14,
+		12, 16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+	};
+
+	const u8 DUTY_TABLE[4][8] = {
+		{ 0, 1, 0, 0, 0, 0, 0, 0 },
+		{ 0, 1, 1, 0, 0, 0, 0, 0 },
+		{ 0, 1, 1, 1, 1, 0, 0, 0 },
+		{ 1, 0, 0, 1, 1, 1, 1, 1 }
+	};
+
+	const u8 TRIANGLE_TABLE[32] = {
+		15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+	};
+
+	// NTSC timer periods in CPU cycles
+	const u16 NOISE_PERIODS[16] = {
+		4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
+	};
+	const u16 DMC_PERIODS[16] = {
+		428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54
+	};
+
+	// Frame counter steps (CPU cycles after the sequencer reset) for the
+	// 4 and 5 step modes, and the length of a whole sequence.
+	const u32 FRAME_STEPS[2][5] = {
+		{ 7457, 14913, 22371, 29829, 0 },
+		{ 7457, 14913, 22371, 29829, 37281 }
+	};
+	const u8 FRAME_STEP_COUNT[2] = { 4, 5 };
+	const u32 FRAME_PERIOD[2] = { 29830, 37282 };
+
+	// Each DMC sample byte fetch halts the CPU for about four cycles
+	const unsigned int DMC_FETCH_STALL = 4;
+
+	// Moves a timer event that can't affect the output past end, in whole
+	// periods so the timer keeps its phase.
+	inline void skip_to(u64& next, u64 period, u64 end) {
+		if (next < end) next += (end - next + period - 1) / period * period;
+	}
+
+	inline u64 earliest(u64 a, u64 b) {
+		return a < b ? a : b;
+	}
+}
+
+APU::APU(Cartridge* cartridge) : cartridge(cartridge) {
+	output = NULL;
+	recorder = NULL;
+	dropped_samples = 0;
+
+	for (int i = 0; i < 2; i++) {
+		Pulse& channel = pulse[i];
+		channel.envelope = Envelope();
+		channel.enabled = false;
+		channel.ones_complement = i == 0;
+		channel.duty = 0;
+		channel.step = 0;
+		channel.timer = 0;
+		channel.length = 0;
+		channel.sweep_enabled = false;
+		channel.sweep_negate = false;
+		channel.sweep_reload = false;
+		channel.sweep_period = 0;
+		channel.sweep_shift = 0;
+		channel.sweep_divider = 0;
+		channel.next = 0;
+	}
+
+	triangle = Triangle();
+	noise = Noise();
+	noise.period = NOISE_PERIODS[0];
+	noise.shift = 1;
+
+	dmc = DMC();
+	dmc.period = DMC_PERIODS[0];
+	dmc.sample_address = 0xC000;
+	dmc.sample_length = 1;
+	dmc.buffer_empty = true;
+	dmc.bits = 8;
+	dmc.silence = true;
+
+	five_step = false;
+	irq_inhibit = false;
+	frame_irq = false;
+	frame_step = 0;
+	frame_base = 0;
+
+	clock = 0;
+	time = 0;
+	frame_start = 0;
+	stall_cycles = 0;
+
+	// Approximations of the 2A03's nonlinear DAC mixing from the nesdev
+	// wiki, the pulse channels share one DAC and the rest another.
+	pulse_table[0] = 0.0f;
+	for (int i = 1; i < 31; i++) pulse_table[i] = static_cast<float>(95.52 / (8128.0 / i + 100.0));
+	tnd_table[0] = 0.0f;
+	for (int i = 1; i < 203; i++) tnd_table[i] = static_cast<float>(163.67 / (24329.0 / i + 100.0));
+	level = 0.0f;
+
+	setSampleRate(DEFAULT_SAMPLE_RATE);
+}
+
+void APU::setSampleRate(unsigned int rate) {
+	sample_rate = rate;
+	blip.setRates(CLOCK_RATE, rate);
+	blip.clear();
+	level = 0.0f;
+	updateOutput(time);
+}
+
+unsigned int APU::getSampleRate() {
+	return sample_rate;
+}
+
+void APU::setOutput(RingBuffer<s16>* output) {
+	this->output = output;
+}
+
+void APU::setRecorder(AudioRecorder* recorder) {
+	this->recorder = recorder;
+}
+
+unsigned long APU::getDroppedSamples() {
+	return dropped_samples;
+}
+
+RateControl& APU::getRateControl() {
+	return rate_control;
+}
+
+void APU::writeRegister(u16 address, u8 value) {
+	// Everything before the write has to be heard with the old settings
+	catchUp();
+
+	switch (address) {
+		case 0x4000:
+		case 0x4004: {
+			Pulse& channel = pulse[(address >> 2) & 0x1];
+			channel.duty = value >> 6;
+			channel.envelope.loop = value & 0x20;
+			channel.envelope.constant = value & 0x10;
+			channel.envelope.period = value & 0x0F;
+			break;
+		}
+		case 0x4001:
+		case 0x4005: {
+			Pulse& channel = pulse[(address >> 2) & 0x1];
+			channel.sweep_enabled = value & 0x80;
+			channel.sweep_period = (value >> 4) & 0x07;
+			channel.sweep_negate = value & 0x08;
+			channel.sweep_shift = value & 0x07;
+			channel.sweep_reload = true;
+			break;
+		}
+		case 0x4002:
+		case 0x4006: {
+			Pulse& channel = pulse[(address >> 2) & 0x1];
+			channel.timer = (channel.timer & 0x700) | value;
+			break;
+		}
+		case 0x4003:
+		case 0x4007: {
+			Pulse& channel = pulse[(address >> 2) & 0x1];
+			channel.timer = (channel.timer & 0x0FF) | ((value & 0x07) << 8);
+			if (channel.enabled) channel.length = LENGTH_TABLE[value >> 3];
+			channel.step = 0;
+			channel.envelope.start = true;
+			break;
+		}
+
+		case 0x4008:
+			triangle.control = value & 0x80;
+			triangle.linear_period = value & 0x7F;
+			break;
+		case 0x400A:
+			triangle.timer = (triangle.timer & 0x700) | value;
+			break;
+		case 0x400B:
+			triangle.timer = (triangle.timer & 0x0FF) | ((value & 0x07) << 8);
+			if (triangle.enabled) triangle.length = LENGTH_TABLE[value >> 3];
+			triangle.linear_reload = true;
+			break;
+
+		case 0x400C:
+			noise.envelope.loop = value & 0x20;
+			noise.envelope.constant = value & 0x10;
+			noise.envelope.period = value & 0x0F;
+			break;
+		case 0x400E:
+			noise.mode = value & 0x80;
+			noise.period = NOISE_PERIODS[value & 0x0F];
+			break;
+		case 0x400F:
+			if (noise.enabled) noise.length = LENGTH_TABLE[value >> 3];
+			noise.envelope.start = true;
+			break;
+
+		case 0x4010:
+			dmc.irq_enabled = value & 0x80;
+			if (!dmc.irq_enabled) dmc.irq = false;
+			dmc.loop = value & 0x40;
+			dmc.period = DMC_PERIODS[value & 0x0F];
+			break;
+		case 0x4011:
+			dmc.level = value & 0x7F;
+			break;
+		case 0x4012:
+			dmc.sample_address = 0xC000 + value * 64;
+			break;
+		case 0x4013:
+			dmc.sample_length = value * 16 + 1;
+			break;
+
+		case 0x4015:
+			pulse[0].enabled = value & 0x01;
+			pulse[1].enabled = value & 0x02;
+			triangle.enabled = value & 0x04;
+			noise.enabled = value & 0x08;
+			dmc.enabled = value & 0x10;
+			if (!pulse[0].enabled) pulse[0].length = 0;
+			if (!pulse[1].enabled) pulse[1].length = 0;
+			if (!triangle.enabled) triangle.length = 0;
+			if (!noise.enabled) noise.length = 0;
+
+			dmc.irq = false;
+			if (!dmc.enabled) {
+				dmc.remaining = 0;
+			} else if (dmc.remaining == 0) {
+				dmc.address = dmc.sample_address;
+				dmc.remaining = dmc.sample_length;
+				fetchDMCSample();
+			}
+			break;
+
+		case 0x4017:
+			five_step = value & 0x80;
+			irq_inhibit = value & 0x40;
+			if (irq_inhibit) frame_irq = false;
+
+			// Restarts the sequence, the 5 step mode clocks everything
+			// right away.
+			frame_step = 0;
+			frame_base = time;
+			if (five_step) {
+				quarterFrame();
+				halfFrame();
+			}
+			break;
+	}
+
+	updateOutput(time);
+}
+
+u8 APU::readStatus() {
+	catchUp();
+
+	u8 status = 0;
+	if (pulse[0].length > 0) status |= 0x01;
+	if (pulse[1].length > 0) status |= 0x02;
+	if (triangle.length > 0) status |= 0x04;
+	if (noise.length > 0) status |= 0x08;
+	if (dmc.remaining > 0) status |= 0x10;
+	if (frame_irq) status |= 0x40;
+	if (dmc.irq) status |= 0x80;
+
+	// Reading acknowledges the frame interrupt
+	frame_irq = false;
+	return status;
+}
+
+void APU::endFrame(bool render) {
+	catchUp();
+
+	blip.endFrame(static_cast<u32>(clock - frame_start));
+	frame_start = clock;
+
+	unsigned int count = blip.samplesAvailable();
+	if (samples.size() < count) samples.resize(count);
+	blip.readSamples(samples.data(), count);
+	if (recorder) recorder->write(samples.data(), count);
+
+	if (output && render) {
+		size_t before = output->size();
+		size_t pushed = output->push(samples.data(), count);
+		dropped_samples += count - pushed;
+
+		// The next frame is synthesized at the adjusted rate
+		double ratio = rate_control.update(before + pushed / 2, output->capacity());
+		blip.setRates(CLOCK_RATE, sample_rate * ratio);
+	}
+}
+
+void APU::catchUp() {
+	while (time < clock) {
+		u64 event = nextFrameEvent();
+		runChannels(earliest(event, clock));
+		if (time == event) {
+			clockFrameCounter();
+			updateOutput(time);
+		}
+	}
+}
+
+void APU::runChannels(u64 end) {
+	// Channels that are silent for the whole stretch (their state only
+	// changes on frame counter steps and register writes, which end a
+	// stretch) get their timers moved past it instead of stepped.
+	for (int i = 0; i < 2; i++) {
+		Pulse& channel = pulse[i];
+		if (channel.length == 0 || channel.muted() || channel.envelope.volume() == 0)
+			skip_to(channel.next, (channel.timer + 1) * 2, end);
+	}
+	if (!triangle.active()) skip_to(triangle.next, triangle.timer + 1, end);
+	if (noise.length == 0 || noise.envelope.volume() == 0) skip_to(noise.next, noise.period, end);
+	if (dmc.silence && dmc.buffer_empty && dmc.remaining == 0 && dmc.next < end) {
+		// The output unit keeps counting bits while idle
+		u64 steps = (end - dmc.next + dmc.period - 1) / dmc.period;
+		dmc.bits = static_cast<u8>((dmc.bits + 7 - steps % 8) % 8 + 1);
+		dmc.next += steps * dmc.period;
+	}
+
+	while (true) {
+		u64 at = earliest(earliest(pulse[0].next, pulse[1].next), earliest(earliest(triangle.next, noise.next), dmc.next));
+		if (at >= end) break;
+
+		for (int i = 0; i < 2; i++) {
+			if (pulse[i].next != at) continue;
+			pulse[i].step = (pulse[i].step + 7) & 0x07;
+			pulse[i].next += (pulse[i].timer + 1) * 2;
+		}
+		if (triangle.next == at) {
+			triangle.step = (triangle.step + 1) & 0x1F;
+			triangle.next += triangle.timer + 1;
+		}
+		if (noise.next == at) {
+			u16 tap = noise.mode ? 6 : 1;
+			u16 feedback = (noise.shift ^ (noise.shift >> tap)) & 0x1;
+			noise.shift = (noise.shift >> 1) | (feedback << 14);
+			noise.next += noise.period;
+		}
+		if (dmc.next == at) {
+			clockDMC();
+			dmc.next += dmc.period;
+		}
+		updateOutput(at);
+	}
+	time = end;
+}
+
+void APU::updateOutput(u64 at) {
+	u8 pulses = pulse[0].output() + pulse[1].output();
+	u8 tnd = 3 * triangle.output() + 2 * noise.output() + dmc.level;
+	float mixed = pulse_table[pulses] + tnd_table[tnd];
+	if (mixed == level) return;
+	blip.addDelta(static_cast<u32>(at - frame_start), mixed - level);
+	level = mixed;
+}
+
+u64 APU::nextFrameEvent() {
+	return frame_base + FRAME_STEPS[five_step][frame_step];
+}
+
+void APU::clockFrameCounter() {
+	// 4 step: quarter quarter+half quarter quarter+half+irq
+	// 5 step: quarter quarter+half quarter - quarter+half
+	u8 last = FRAME_STEP_COUNT[five_step] - 1;
+	if (!(five_step && frame_step == 3)) quarterFrame();
+	if (frame_step == 1 || frame_step == last) halfFrame();
+	if (!five_step && frame_step == last && !irq_inhibit) frame_irq = true;
+
+	if (frame_step++ == last) {
+		frame_step = 0;
+		frame_base += FRAME_PERIOD[five_step];
+	}
+}
+
+void APU::quarterFrame() {
+	pulse[0].envelope.clock();
+	pulse[1].envelope.clock();
+	noise.envelope.clock();
+
+	if (triangle.linear_reload) triangle.linear_counter = triangle.linear_period;
+	else if (triangle.linear_counter > 0) triangle.linear_counter--;
+	if (!triangle.control) triangle.linear_reload = false;
+}
+
+void APU::halfFrame() {
+	for (int i = 0; i < 2; i++) {
+		if (!pulse[i].envelope.loop && pulse[i].length > 0) pulse[i].length--;
+		clockSweep(pulse[i]);
+	}
+	if (!triangle.control && triangle.length > 0) triangle.length--;
+	if (!noise.envelope.loop && noise.length > 0) noise.length--;
+}
+
+void APU::clockSweep(Pulse& channel) {
+	if (channel.sweep_divider == 0 && channel.sweep_enabled && channel.sweep_shift > 0 && !channel.muted())
+		channel.timer = channel.sweepTarget();
+
+	if (channel.sweep_divider == 0 || channel.sweep_reload) {
+		channel.sweep_divider = channel.sweep_period;
+		channel.sweep_reload = false;
+	} else {
+		channel.sweep_divider--;
+	}
+}
+
+void APU::clockDMC() {
+	if (!dmc.silence) {
+		if (dmc.shift & 0x1) {
+			if (dmc.level <= 125) dmc.level += 2;
+		} else {
+			if (dmc.level >= 2) dmc.level -= 2;
+		}
+	}
+	dmc.shift >>= 1;
+
+	if (--dmc.bits == 0) {
+		dmc.bits = 8;
+		dmc.silence = dmc.buffer_empty;
+		if (!dmc.buffer_empty) {
+			dmc.shift = dmc.buffer;
+			dmc.buffer_empty = true;
+			fetchDMCSample();
+		}
+	}
+}
+
+void APU::fetchDMCSample() {
+	if (!dmc.buffer_empty || dmc.remaining == 0) return;
+
+	dmc.buffer = cartridge ? cartridge->read(dmc.address) : 0;
+#ifdef NES_COVERAGE
+	if (cartridge) cartridge->markPRG(dmc.address, coverage::PCM);
+#endif
+	dmc.buffer_empty = false;
+	stall_cycles += DMC_FETCH_STALL;
+
+	// Sample addresses wrap around to $8000
+	dmc.address = dmc.address == 0xFFFF ? 0x8000 : dmc.address + 1;
+	if (--dmc.remaining == 0) {
+		if (dmc.loop) {
+			dmc.address = dmc.sample_address;
+			dmc.remaining = dmc.sample_length;
+		} else if (dmc.irq_enabled) {
+			dmc.irq = true;
+		}
+	}
+}
+
+void APU::Envelope::clock() {
+	if (start) {
+		start = false;
+		decay = 15;
+		divider = period;
+	} else if (divider == 0) {
+		divider = period;
+		if (decay > 0) decay--;
+		else if (loop) decay = 15;
+	} else {
+		divider--;
+	}
+}
+
+u8 APU::Envelope::volume() const {
+	return constant ? period : decay;
+}
+
+u16 APU::Pulse::sweepTarget() const {
+	u16 change = timer >> sweep_shift;
+	if (!sweep_negate) return timer + change;
+
+	// Pulse 1 subtracts one more (ones' complement adder)
+	u16 subtract = change + (ones_complement ? 1 : 0);
+	return subtract > timer ? 0 : timer - subtract;
+}
+
+bool APU::Pulse::muted() const {
+	return timer < 8 || (!sweep_negate && sweepTarget() > 0x7FF);
+}
+
+u8 APU::Pulse::output() const {
+	if (length == 0 || muted() || !DUTY_TABLE[duty][step]) return 0;
+	return envelope.volume();
+}
+
+bool APU::Triangle::active() const {
+	// Ultrasonic periods are treated as silence (holding the current
+	// step) like most emulators do, they would only be heard as a pop.
+	return length > 0 && linear_counter > 0 && timer >= 2;
+}
+
+u8 APU::Triangle::output() const {
+	return TRIANGLE_TABLE[step];
+}
+
+u8 APU::Noise::output() const {
+	if (length == 0 || (shift & 0x1)) return 0;
+	return envelope.volume();
+}
@@ -0,0 +1,203 @@
+#ifndef APU_H
+#define APU_H
+
+#include <vector>
+
+#include "definitions.h"
+#include "cartridge.h"
+#include "blip_buffer.h"
+#include "ring_buffer.h"
+#include "rate_control.h"
+#include "audio_recorder.h"
+
+/*
+2A03 audio processing unit: two pulse channels, triangle, noise, DMC and
+the frame counter that clocks their envelopes, sweeps and length
+counters.
+
+Nothing is done per CPU cycle. run() only moves the APU clock forward,
+the channels are caught up lazily (on register accesses and at the end
+of each frame) by jumping straight from one timer event to the next.
+Every change of the mixed output goes into a BlipBuffer as a
+band-limited step, and the finished samples of each frame are pushed
+into the output ring buffer for the audio thread.
+*/
+
+class APU {
+public:
+	// DMC samples are fetched from cartridge space, may be NULL
+	APU(Cartridge* cartridge);
+
+	void setSampleRate(unsigned int rate);
+	unsigned int getSampleRate();
+
+	// Where finished samples go, NULL throws them away
+	void setOutput(RingBuffer<s16>* output);
+
+	// Also hands every frame's samples to a recorder, NULL to stop
+	void setRecorder(AudioRecorder* recorder);
+
+	// $4000-$4013, $4015 and $4017
+	void writeRegister(u16 address, u8 value);
+	// $4015
+	u8 readStatus();
+
+	// Advances the APU clock by cycles CPU cycles, called after every
+	// instruction so it is kept inline.
+	void run(unsigned int cycles) { clock += cycles; }
+
+	// Synthesizes everything up to now and outputs the frame's samples.
+	// Frames that aren't rendered (skipped or turbo) only go to the
+	// recorder, they would overrun the output and throw off its rate.
+	void endFrame(bool render = true);
+
+	// CPU cycles stolen by DMC sample fetches since the last call. Fetches
+	// are only found while catching up, on register accesses and at the
+	// end of a frame, and are owed to the instruction that caused that.
+	bool hasStallCycles() const { return stall_cycles != 0; }
+	unsigned int takeStallCycles() {
+		unsigned int cycles = stall_cycles;
+		stall_cycles = 0;
+		return cycles;
+	}
+
+	// Samples that didn't fit in the output ring buffer
+	unsigned long getDroppedSamples();
+
+	// Nudges the output rate to keep the output ring buffer half full
+	RateControl& getRateControl();
+private:
+	struct Envelope {
+		bool start;
+		bool loop;
+		bool constant;
+		u8 period;
+		u8 divider;
+		u8 decay;
+
+		void clock();
+		u8 volume() const;
+	};
+
+	struct Pulse {
+		Envelope envelope;
+		bool enabled;
+		bool ones_complement;	// Pulse 1 negates its sweep differently
+		u8 duty;
+		u8 step;
+		u16 timer;
+		u8 length;
+
+		bool sweep_enabled;
+		bool sweep_negate;
+		bool sweep_reload;
+		u8 sweep_period;
+		u8 sweep_shift;
+		u8 sweep_divider;
+
+		u64 next;	// APU clock of the next timer event
+
+		u16 sweepTarget() const;
+		bool muted() const;
+		u8 output() const;
+	};
+
+	struct Triangle {
+		bool enabled;
+		bool control;
+		bool linear_reload;
+		u8 linear_period;
+		u8 linear_counter;
+		u8 step;
+		u16 timer;
+		u8 length;
+
+		u64 next;
+
+		bool active() const;
+		u8 output() const;
+	};
+
+	struct Noise {
+		Envelope envelope;
+		bool enabled;
+		bool mode;
+		u16 period;
+		u16 shift;
+		u8 length;
+
+		u64 next;
+
+		u8 output() const;
+	};
+
+	struct DMC {
+		bool enabled;
+		bool irq_enabled;
+		bool irq;
+		bool loop;
+		u16 period;
+		u8 level;
+
+		u16 sample_address;
+		u16 sample_length;
+		u16 address;
+		u16 remaining;
+
+		u8 buffer;
+		bool buffer_empty;
+		u8 shift;
+		u8 bits;
+		bool silence;
+
+		u64 next;
+	};
+
+	Cartridge* cartridge;
+	RingBuffer<s16>* output;
+	AudioRecorder* recorder;
+	unsigned long dropped_samples;
+
+	Pulse pulse[2];
+	Triangle triangle;
+	Noise noise;
+	DMC dmc;
+
+	// Frame counter
+	bool five_step;
+	bool irq_inhibit;
+	bool frame_irq;
+	u8 frame_step;
+	u64 frame_base;	// APU clock of the sequencer's last reset/wrap
+
+	// clock is where the CPU is, time is how far synthesis has caught up
+	u64 clock;
+	u64 time;
+	u64 frame_start;
+	unsigned int stall_cycles;
+
+	// Nonlinear mixer lookup tables
+	float pulse_table[31];
+	float tnd_table[203];
+	float level;
+
+	BlipBuffer blip;
+	RateControl rate_control;
+	unsigned int sample_rate;
+	std::vector<s16> samples;
+
+	void catchUp();
+	void runChannels(u64 end);
+	void updateOutput(u64 at);
+
+	u64 nextFrameEvent();
+	void clockFrameCounter();
+	void quarterFrame();
+	void halfFrame();
+	void clockSweep(Pulse& channel);
+
+	void clockDMC();
+	void fetchDMCSample();
+};
+
+#endif // APU_H
@@ -0,0 +1,94 @@
+#include "audio_recorder.h"
+
+#include <string.h>
+
+namespace {
+	const unsigned int WAV_HEADER_SIZE = 44;
+
+	void put_u16(u8* out, u16 value) {
+		out[0] = value & 0xFF;
+		out[1] = value >> 8;
+	}
+
+	void put_u32(u8* out, u32 value) {
+		put_u16(out, value & 0xFFFF);
+		put_u16(out + 2, value >> 16);
+	}
+}
+
+AudioRecorder::AudioRecorder(const std::string filename, AudioFormat format, unsigned int input_rate,
+	unsigned int output_rate, ResampleQuality quality) : format(format), rate(output_rate) {
+	samples_written = 0;
+	if (input_rate != output_rate) resampler.reset(new Resampler(input_rate, output_rate, quality));
+
+	file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		printf("ERROR: Unable to open %s for writing!\n", filename.c_str());
+		return;
+	}
+	if (format == AudioFormat::WAV) writeHeader();
+}
+
+AudioRecorder::~AudioRecorder() {
+	close();
+}
+
+bool AudioRecorder::isOpen() {
+	return file != NULL;
+}
+
+void AudioRecorder::write(const s16* samples, size_t count) {
+	if (file == NULL) return;
+
+	if (resampler) {
+		converted.clear();
+		resampler->process(samples, count, converted);
+		samples = converted.data();
+		count = converted.size();
+	}
+
+	// Samples are stored little endian in both formats
+	bytes.resize(count * 2);
+	for (size_t i = 0; i < count; i++) put_u16(&bytes[i * 2], static_cast<u16>(samples[i]));
+	fwrite(bytes.data(), 1, bytes.size(), file);
+	samples_written += count;
+}
+
+void AudioRecorder::close() {
+	if (file == NULL) return;
+	if (format == AudioFormat::WAV) {
+		fseek(file, 0, SEEK_SET);
+		writeHeader();
+	}
+	fclose(file);
+	file = NULL;
+}
+
+unsigned long AudioRecorder::getSamplesWritten() {
+	return samples_written;
+}
+
+void AudioRecorder::writeHeader() {
+	u32 data_size = samples_written * 2;
+	u8 header[WAV_HEADER_SIZE];
+	memcpy(header, "RIFF", 4);
+	put_u32(header + 4, WAV_HEADER_SIZE - 8 + data_size);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	put_u32(header + 16, 16);			// fmt chunk size
+	put_u16(header + 20, 1);			// PCM
+	put_u16(header + 22, 1);			// Mono
+	put_u32(header + 24, rate);
+	put_u32(header + 28, rate * 2);	// Byte rate
+	put_u16(header + 32, 2);			// Block align
+	put_u16(header + 34, 16);			// Bits per sample
+	memcpy(header + 36, "data", 4);
+	put_u32(header + 40, data_size);
+	fwrite(header, 1, sizeof(header), file);
+}
+
+bool AudioRecorder::parseFormat(const std::string& name, AudioFormat& format) {
+	if (name == "wav") format = AudioFormat::WAV;
+	else if (name == "raw") format = AudioFormat::RAW;
+	else return false;
+	return true;
+}
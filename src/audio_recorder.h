@@ -0,0 +1,50 @@
+#ifndef AUDIO_RECORDER_H
+#define AUDIO_RECORDER_H
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "resampler.h"
+
+enum class AudioFormat {
+	WAV, RAW
+};
+
+/*
+Records mono 16-bit APU output to a WAV file or raw little endian PCM at
+any sample rate, converting through a Resampler when the file's rate
+differs from the APU's.
+*/
+
+class AudioRecorder {
+public:
+	AudioRecorder(const std::string filename, AudioFormat format, unsigned int input_rate,
+		unsigned int output_rate, ResampleQuality quality = ResampleQuality::MEDIUM);
+	~AudioRecorder();
+
+	bool isOpen();
+	void write(const s16* samples, size_t count);
+
+	// Fills in the WAV header sizes, also done on destruction
+	void close();
+
+	unsigned long getSamplesWritten();
+
+	static bool parseFormat(const std::string& name, AudioFormat& format);
+private:
+	FILE* file;
+	AudioFormat format;
+	unsigned int rate;
+	unsigned long samples_written;
+
+	std::unique_ptr<Resampler> resampler;
+	std::vector<s16> converted;
+	std::vector<u8> bytes;
+
+	void writeHeader();
+};
+
+#endif // AUDIO_RECORDER_H
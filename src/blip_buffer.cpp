@@ -0,0 +1,100 @@
+#include "blip_buffer.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+	const double PI = 3.14159265358979323846;
+
+	// Kernel cutoff as a fraction of the output Nyquist frequency, a bit
+	// under 1 so the transition band doesn't alias back down.
+	const double CUTOFF = 0.9;
+
+	// First order high pass coefficient, about 20Hz at 48kHz. The NES has
+	// a similar filter in its output stage.
+	const float HIGHPASS = 0.0026f;
+
+	// Mixer output is 0 to 1, leave some headroom once centered
+	const float GAIN = 24000.0f;
+
+	const int FRACTION_BITS = 32;
+}
+
+BlipBuffer::BlipBuffer(unsigned int size) {
+	buffer.resize(size + TAPS);
+	factor = 0;
+	clear();
+
+	// Windowed sinc impulse for every phase, centered between the middle
+	// taps and shifted right by the phase. Each phase sums to exactly one
+	// so the integrated step settles at the full delta.
+	for (int phase = 0; phase < PHASES; phase++) {
+		double sum = 0.0;
+		for (int tap = 0; tap < TAPS; tap++) {
+			double x = tap - (TAPS / 2 - 1) - static_cast<double>(phase) / PHASES;
+			double sinc = x == 0.0 ? 1.0 : sin(PI * CUTOFF * x) / (PI * CUTOFF * x);
+			double window = 0.54 + 0.46 * cos(PI * x / (TAPS / 2));
+			kernel[phase][tap] = static_cast<float>(sinc * window);
+			sum += kernel[phase][tap];
+		}
+		for (int tap = 0; tap < TAPS; tap++) kernel[phase][tap] = static_cast<float>(kernel[phase][tap] / sum);
+	}
+}
+
+void BlipBuffer::setRates(double clock_rate, double sample_rate) {
+	factor = static_cast<u64>(sample_rate / clock_rate * (1ULL << FRACTION_BITS) + 0.5);
+}
+
+void BlipBuffer::clear() {
+	memset(buffer.data(), 0, buffer.size() * sizeof(float));
+	available = 0;
+	offset = 0;
+	integrator = 0.0f;
+	dc = 0.0f;
+}
+
+void BlipBuffer::addDelta(u32 time, float delta) {
+	u64 position = offset + time * factor;
+	unsigned int index = available + static_cast<unsigned int>(position >> FRACTION_BITS);
+	int phase = static_cast<int>(position >> (FRACTION_BITS - PHASE_BITS)) & (PHASES - 1);
+
+	// Deltas past the end of a full buffer are dropped, the caller is
+	// expected to read out every frame.
+	if (index + TAPS > buffer.size()) return;
+	float* out = &buffer[index];
+	const float* taps = kernel[phase];
+	for (int i = 0; i < TAPS; i++) out[i] += taps[i] * delta;
+}
+
+void BlipBuffer::endFrame(u32 time) {
+	u64 position = offset + time * factor;
+	available += static_cast<unsigned int>(position >> FRACTION_BITS);
+	offset = position & ((1ULL << FRACTION_BITS) - 1);
+	if (available > buffer.size() - TAPS) available = buffer.size() - TAPS;
+}
+
+unsigned int BlipBuffer::samplesAvailable() {
+	return available;
+}
+
+unsigned int BlipBuffer::readSamples(s16* out, unsigned int count) {
+	if (count > available) count = available;
+
+	for (unsigned int i = 0; i < count; i++) {
+		integrator += buffer[i];
+		float sample = integrator - dc;
+		dc += sample * HIGHPASS;
+
+		float scaled = sample * GAIN;
+		if (scaled > 32767.0f) scaled = 32767.0f;
+		if (scaled < -32768.0f) scaled = -32768.0f;
+		out[i] = static_cast<s16>(scaled);
+	}
+
+	// Keep the tails of the kernels that reach into the next samples
+	unsigned int remaining = available - count + TAPS;
+	memmove(buffer.data(), &buffer[count], remaining * sizeof(float));
+	memset(&buffer[remaining], 0, count * sizeof(float));
+	available -= count;
+	return count;
+}
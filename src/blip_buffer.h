@@ -0,0 +1,54 @@
+#ifndef BLIP_BUFFER_H
+#define BLIP_BUFFER_H
+
+#include <vector>
+
+#include "definitions.h"
+
+/*
+Band-limited synthesis buffer. Instead of sampling the APU at its own
+1.79MHz clock and filtering that down, every change of the output level
+is added as a band-limited step (a windowed sinc impulse, integrated
+when the samples are read out) at its exact fractional output sample
+position. The cost is per level change instead of per clock.
+*/
+
+class BlipBuffer {
+public:
+	// Sub-sample resolution of delta positions and taps per delta
+	static const int PHASE_BITS = 5;
+	static const int PHASES = 1 << PHASE_BITS;
+	static const int TAPS = 16;
+
+	BlipBuffer(unsigned int size = 4096);
+
+	// Input clocks per second and output samples per second
+	void setRates(double clock_rate, double sample_rate);
+	void clear();
+
+	// Adds a level change at time clocks after the start of the frame
+	void addDelta(u32 time, float delta);
+
+	// Ends the frame at time clocks, making its samples readable. The next
+	// frame starts at time 0 again.
+	void endFrame(u32 time);
+
+	unsigned int samplesAvailable();
+	unsigned int readSamples(s16* out, unsigned int count);
+private:
+	std::vector<float> buffer;
+	unsigned int available;
+
+	// Output samples per clock and the position of the frame start, both
+	// 32.32 fixed point.
+	u64 factor;
+	u64 offset;
+
+	// Read out state, the running sum of the deltas and a DC blocker
+	float integrator;
+	float dc;
+
+	float kernel[PHASES][TAPS];
+};
+
+#endif // BLIP_BUFFER_H
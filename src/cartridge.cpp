@@ -1,5 +1,7 @@
 #include "cartridge.h"
 
+#include <string.h>
+
 namespace {
 	const uint16_t PGR_ROM_CODE = 0x4;
 	const uint16_t CHR_ROM_CODE = 0x5;
@@ -7,8 +9,6 @@ namespace {
 	const uint16_t FLAGS_6_CODE = 0x6;
 	const uint16_t FLAGS_7_CODE = 0x7;
 	const uint16_t FLAGS_9_CODE	= 0x9;
-
-	const uint8_t HEADER_SIZE	= 0x10;
 }
 
 Cartridge::Cartridge(const std::string filename) {
@@ -35,8 +35,26 @@ Cartridge::Cartridge(const std::string filename) {
 	data.resize(file_size);
 	rom_file.read(reinterpret_cast<char*>(data.data()), file_size);
 
+	parseHeader();
+}
+
+Cartridge::Cartridge(const std::vector<uint8_t>& rom) : data(rom) {
+	printf("\n+----------------------+\n");
+	printf("|READING CARTRIDGE DATA|\n");
+	printf("+----------------------+\n\n");
+	printf("ROM IMAGE SIZE: %lu bytes\n", rom.size());
+
+	parseHeader();
+}
+
+void Cartridge::parseHeader() {
 	// Read header and set data accordingly
 	prg_rom_size = data[PGR_ROM_CODE] * 16;
+	if (prg_rom_size == 0) {
+		// Mapped as one bank of zeros so there is still something to read
+		printf("WARNING: The header says there is no PRG ROM, using 16KB of zeros\n");
+		prg_rom_size = 16;
+	}
 	chr_rom_size = data[CHR_ROM_CODE] * 8;
 	prg_ram_size = data[PRG_RAM_CODE] * 8;
 	if (prg_ram_size == 0) prg_ram_size = 8;	// Compatibility
@@ -60,16 +78,70 @@ Cartridge::Cartridge(const std::string filename) {
 	printf("CHR ROM SIZE: %iKB\n", chr_rom_size);
 	printf("PRG RAM SIZE: %iKB\n", prg_ram_size);
 	printf("MAPPER NUMBER: %i\n", mapper_number);
+
+#ifdef NES_COVERAGE
+	prg_coverage.assign(prg_rom_size * 1024, 0);
+#endif
+
+	// Short files read as zeros instead of past the end
+	if (data.size() < HEADER_SIZE + prg_rom_size * 1024) data.resize(HEADER_SIZE + prg_rom_size * 1024, 0);
+	mapPRG();
 }
 
 uint8_t Cartridge::read(unsigned int address) {
-	// Mapper 0 16KB (First bank is mapped to 0x8000-0xBFFF and mirrored to 0xC000-0xFFFF)
-	if (0x8000 <= address && address <= 0xBFFF) {
-		return data[address-0x8000+HEADER_SIZE];
-	}
-	if (0xC000 <= address && address <= 0xFFFF) {
-		return data[address-0xC000+HEADER_SIZE];
+	if (0x8000 <= address && address <= 0xFFFF) {
+		return prg_pages[(address >> 8) & 0x7F][address & 0xFF];
 	}
 	printf("Unable to read data from cartridge at address %04X\n", address);
 	return 0x00;
-}
\ No newline at end of file
+}
+
+void Cartridge::addCheat(const Cheat& cheat) {
+	// Sized once, the page table keeps pointers into it
+	if (patched_prg.empty()) patched_prg.resize(sizeof(prg_pages) / sizeof(prg_pages[0]) * 0x100);
+	cheats.push_back(cheat);
+	mapPRG();
+}
+
+void Cartridge::clearCheats() {
+	cheats.clear();
+	mapPRG();
+}
+
+void Cartridge::mapPRG() {
+	for (unsigned int page = 0; page < 0x80; page++) prg_pages[page] = mappedROM(page);
+
+	// Each patched page is copied from whatever bank is mapped there now,
+	// compares are against that bank's ROM byte.
+	for (const Cheat& cheat : cheats) {
+		unsigned int page = (cheat.address >> 8) & 0x7F;
+		const uint8_t* rom = mappedROM(page);
+		if (cheat.compare >= 0 && rom[cheat.address & 0xFF] != cheat.compare) continue;
+		uint8_t* copy = &patched_prg[page << 8];
+		if (prg_pages[page] != copy) {
+			memcpy(copy, rom, 0x100);
+			prg_pages[page] = copy;
+		}
+		copy[cheat.address & 0xFF] = cheat.value;
+	}
+}
+
+// ROM page mapped at $8000 + page * $100. Mapper 0, 16KB games see their
+// only bank at $8000 and again at $C000, 32KB games fill the whole range.
+const uint8_t* Cartridge::mappedROM(unsigned int page) {
+	return &data[HEADER_SIZE + ((page << 8) % (prg_rom_size * 1024))];
+}
+
+u8 Cartridge::getMapperNumber() {
+	return mapper_number;
+}
+
+unsigned int Cartridge::getCHRSize() {
+	return chr_rom_size * 1024;
+}
+
+#ifdef NES_COVERAGE
+const std::vector<u8>& Cartridge::getPRGCoverage() {
+	return prg_coverage;
+}
+#endif
@@ -8,6 +8,7 @@
 
 #include "bitwise.h"
 #include "definitions.h"
+#include "cheat.h"
 
 enum class Mirroring {
 	HORIZONTAL, VERTICAL
@@ -20,10 +21,40 @@ enum class TVSystem {
 class Cartridge {
 public:
 	Cartridge(const std::string filename);
+	Cartridge(const std::vector<uint8_t>& rom);	// An iNES image already in memory
 	uint8_t read(unsigned int address);
 
+	// Direct pointer to the 256 byte PRG page containing address as read()
+	// sees it (cheats included), or NULL if the page isn't ROM.
+	const uint8_t* getPagePointer(unsigned int address) {
+		if (address < 0x8000 || address > 0xFFFF) return NULL;
+		return prg_pages[(address >> 8) & 0x7F];
+	}
+
+	// Patches PRG ROM through the page table. Only the pages a cheat
+	// touches point at a private patched copy, reads of every page cost
+	// the same with or without cheats. Add them before running, the CPU
+	// caches what it learned about loops in ROM.
+	void addCheat(const Cheat& cheat);
+	void clearCheats();
+
 	u8 getMapperNumber();
+	unsigned int getCHRSize();
+
+#ifdef NES_COVERAGE
+	// ORs access flags (see coverage.h) and the CDL bank bits of address
+	// into the byte of physical PRG ROM it maps to. Same mapper 0 layout
+	// as read(), bits 2-3 of a CDL byte hold which 8KB slot of
+	// $8000-$FFFF the byte was seen in.
+	void markPRG(unsigned int address, u8 access) {
+		if (address >= 0x8000 && !prg_coverage.empty())
+			prg_coverage[(address - 0x8000) % prg_coverage.size()] |= access | ((address >> 11) & 0x0C);
+	}
+	const std::vector<u8>& getPRGCoverage();
+#endif
 private:
+	static const unsigned int HEADER_SIZE = 0x10;
+
 	std::vector<uint8_t> data;
 	unsigned int prg_rom_size;
 	unsigned int chr_rom_size;
@@ -43,6 +74,23 @@ private:
 	TVSystem tv_system;
 
 	uint8_t mapper_number;
+
+	// $8000-$FFFF in 256 byte pages, into data or patched_prg
+	const uint8_t* prg_pages[0x80];
+	std::vector<Cheat> cheats;
+	std::vector<uint8_t> patched_prg;	// A page sized slot for each entry of prg_pages
+
+	void parseHeader();
+
+	// Rebuilds the page table from the banks mapped now and patches it
+	// again, a mapper with bank switching calls this after every switch
+	// so the patched copies follow the banks.
+	void mapPRG();
+	const uint8_t* mappedROM(unsigned int page);
+
+#ifdef NES_COVERAGE
+	std::vector<u8> prg_coverage;
+#endif
 };
 
 #endif // CARTRIDGE_H
\ No newline at end of file
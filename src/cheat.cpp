@@ -0,0 +1,64 @@
+#include "cheat.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+namespace {
+	// Game Genie letters in the order of the nibble they stand for
+	const char GAME_GENIE_LETTERS[] = "APZLGITYEOXUKSVN";
+
+	bool parse_game_genie(const std::string& text, Cheat& cheat) {
+		if (text.size() != 6 && text.size() != 8) return false;
+		u8 n[8];
+		for (size_t i = 0; i < text.size(); i++) {
+			const char* letter = strchr(GAME_GENIE_LETTERS, toupper(static_cast<unsigned char>(text[i])));
+			if (letter == NULL || *letter == '\0') return false;
+			n[i] = static_cast<u8>(letter - GAME_GENIE_LETTERS);
+		}
+
+		// The bits of address, value and compare are scattered over the
+		// letters, the high bit of each letter mostly belongs to the next
+		cheat.address = 0x8000 | ((n[3] & 7) << 12) | ((n[5] & 7) << 8) | ((n[4] & 8) << 8) |
+			((n[2] & 7) << 4) | ((n[1] & 8) << 4) | (n[4] & 7) | (n[3] & 8);
+		cheat.value = ((n[1] & 7) << 4) | ((n[0] & 8) << 4) | (n[0] & 7);
+		if (text.size() == 6) {
+			cheat.value |= n[5] & 8;
+			cheat.compare = -1;
+		}
+		else {
+			cheat.value |= n[7] & 8;
+			cheat.compare = ((n[7] & 7) << 4) | ((n[6] & 8) << 4) | (n[6] & 7) | (n[5] & 8);
+		}
+		return true;
+	}
+
+	// Hex field of at most digits digits up to the next ':' or the end
+	bool parse_hex(const std::string& text, size_t& position, size_t digits, unsigned long& number) {
+		size_t end = text.find(':', position);
+		if (end == std::string::npos) end = text.size();
+		if (end == position || end - position > digits) return false;
+		for (size_t i = position; i < end; i++) {
+			if (!isxdigit(static_cast<unsigned char>(text[i]))) return false;
+		}
+		number = strtoul(text.substr(position, end - position).c_str(), NULL, 16);
+		position = end + 1;
+		return true;
+	}
+}
+
+bool Cheat::parse(const std::string& text, Cheat& cheat) {
+	if (text.find(':') == std::string::npos) return parse_game_genie(text, cheat);
+
+	size_t position = 0;
+	unsigned long address, value, compare;
+	if (!parse_hex(text, position, 4, address) || address < 0x8000) return false;
+	if (!parse_hex(text, position, 2, value)) return false;
+	cheat.address = static_cast<u16>(address);
+	cheat.value = static_cast<u8>(value);
+	cheat.compare = -1;
+	if (position > text.size()) return true;
+	if (!parse_hex(text, position, 2, compare) || position <= text.size()) return false;
+	cheat.compare = static_cast<int>(compare);
+	return true;
+}
@@ -0,0 +1,25 @@
+#ifndef CHEAT_H
+#define CHEAT_H
+
+#include <string>
+
+#include "definitions.h"
+
+/*
+A PRG ROM patch, from a Game Genie code or a raw one. Codes with a
+compare value only apply where the ROM byte they replace matches it,
+which is how Game Genie codes pick one bank out of several mapped to
+the same address. See Cartridge::addCheat().
+*/
+
+struct Cheat {
+	u16 address;	// $8000-$FFFF
+	u8 value;
+	int compare;	// -1 for none
+
+	// Six or eight letter Game Genie codes, or hex "AAAA:VV" and
+	// "AAAA:VV:CC" (address, value, compare). False if text is neither.
+	static bool parse(const std::string& text, Cheat& cheat);
+};
+
+#endif // CHEAT_H
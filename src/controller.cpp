@@ -0,0 +1,47 @@
+#include "controller.h"
+
+namespace {
+	// Reports past the 8th read return 1 on an official controller
+	const u16 UNUSED_BITS = 0xFF00;
+}
+
+Controller::Controller() {
+	host_buttons = 0;
+	shift_register = UNUSED_BITS;
+	latched_buttons = 0;
+	strobing = false;
+	tracker = NULL;
+}
+
+void Controller::setButtons(u16 buttons) {
+	host_buttons.store(buttons, std::memory_order_relaxed);
+}
+
+u16 Controller::getButtons() {
+	return host_buttons.load(std::memory_order_relaxed);
+}
+
+void Controller::setLatencyTracker(LatencyTracker* tracker) {
+	this->tracker = tracker;
+}
+
+void Controller::latch() {
+	u16 buttons = host_buttons.load(std::memory_order_relaxed);
+	if (tracker && buttons != latched_buttons) tracker->guestLatch();
+	latched_buttons = buttons;
+	shift_register = (buttons & ~UNUSED_BITS) | UNUSED_BITS;
+}
+
+void Controller::strobe(bool on) {
+	// The buttons are reloaded for as long as strobe is high, the state at
+	// the falling edge is what the game gets to read.
+	if (on || strobing) latch();
+	strobing = on;
+}
+
+u8 Controller::read() {
+	if (strobing) latch();
+	u8 bit = shift_register & 0x1;
+	shift_register = (shift_register >> 1) | 0x8000;
+	return bit;
+}
@@ -0,0 +1,53 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <atomic>
+
+#include "definitions.h"
+#include "latency_tracker.h"
+
+// Button bits, in the order the standard controller shifts them out
+namespace buttons {
+	const u16 A = 1 << 0;
+	const u16 B = 1 << 1;
+	const u16 SELECT = 1 << 2;
+	const u16 START = 1 << 3;
+	const u16 UP = 1 << 4;
+	const u16 DOWN = 1 << 5;
+	const u16 LEFT = 1 << 6;
+	const u16 RIGHT = 1 << 7;
+};
+
+/*
+Standard controller plugged into $4016/$4017. The host (any thread)
+sets the buttons currently held, the shift register only samples them
+when the game strobes the port so the game sees the newest input
+possible instead of whatever was there at the start of the frame.
+*/
+
+class Controller {
+public:
+	Controller();
+
+	// Host side, safe to call from another thread
+	void setButtons(u16 buttons);
+	u16 getButtons();
+
+	// Optional, told whenever the game latches a new button state
+	void setLatencyTracker(LatencyTracker* tracker);
+
+	// Bus side, bit 0 of a $4016 write and reads of the port
+	void strobe(bool on);
+	u8 read();
+private:
+	std::atomic<u16> host_buttons;
+	u16 shift_register;
+	u16 latched_buttons;
+	bool strobing;
+
+	LatencyTracker* tracker;
+
+	void latch();
+};
+
+#endif // CONTROLLER_H
@@ -0,0 +1,91 @@
+#include "coverage.h"
+
+#ifdef NES_COVERAGE
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "image_writer.h"
+
+namespace {
+	const int HEATMAP_SIZE = 256;
+
+	// Untouched bytes on a busy page still show up faintly
+	const double MIN_BRIGHTNESS = 0.25;
+
+	void count_flags(const u8* flags, size_t size, size_t counts[3]) {
+		counts[0] = counts[1] = counts[2] = 0;
+		for (size_t i = 0; i < size; i++) {
+			if (flags[i] & coverage::EXECUTE) counts[0]++;
+			if (flags[i] & coverage::READ) counts[1]++;
+			if (flags[i] & coverage::WRITE) counts[2]++;
+		}
+	}
+}
+
+Coverage::Coverage() {
+	memset(flags, 0, sizeof(flags));
+	memset(page_accesses, 0, sizeof(page_accesses));
+}
+
+bool Coverage::writeCDL(const std::string filename, Cartridge& cartridge) {
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		printf("ERROR: Unable to open %s for writing!\n", filename.c_str());
+		return false;
+	}
+
+	// PRG bytes are already in CDL form, CHR is never touched without a PPU
+	const std::vector<u8>& prg = cartridge.getPRGCoverage();
+	std::vector<u8> chr(cartridge.getCHRSize(), 0);
+	bool ok = fwrite(prg.data(), 1, prg.size(), file) == prg.size() &&
+		fwrite(chr.data(), 1, chr.size(), file) == chr.size();
+	fclose(file);
+	return ok;
+}
+
+bool Coverage::writeHeatmap(const std::string filename) {
+	u64 hottest = 0;
+	for (int page = 0; page < 0x100; page++)
+		if (page_accesses[page] > hottest) hottest = page_accesses[page];
+
+	std::vector<u32> pixels(HEATMAP_SIZE * HEATMAP_SIZE);
+	for (int page = 0; page < 0x100; page++) {
+		// Log scale, a handful of accesses shouldn't be invisible next to
+		// the millions on the zero page and stack.
+		double heat = hottest > 1 && page_accesses[page] > 0 ?
+			log(static_cast<double>(page_accesses[page])) / log(static_cast<double>(hottest)) : 0.0;
+		u32 level = static_cast<u32>(255.0 * (MIN_BRIGHTNESS + (1.0 - MIN_BRIGHTNESS) * heat));
+
+		for (int offset = 0; offset < 0x100; offset++) {
+			u8 access = flags[(page << 8) | offset];
+			u32 pixel = 0xFF000000;
+			if (access & coverage::EXECUTE) pixel |= level << 16;
+			if (access & coverage::READ) pixel |= level << 8;
+			if (access & coverage::WRITE) pixel |= level;
+			pixels[page * HEATMAP_SIZE + offset] = pixel;
+		}
+	}
+	return image_writer::write_png(filename, pixels.data(), HEATMAP_SIZE, HEATMAP_SIZE);
+}
+
+void Coverage::report(Cartridge& cartridge) {
+	size_t cpu[3], prg[3];
+	count_flags(flags, sizeof(flags), cpu);
+	const std::vector<u8>& prg_flags = cartridge.getPRGCoverage();
+	count_flags(prg_flags.data(), prg_flags.size(), prg);
+
+	size_t prg_used = 0;
+	for (size_t i = 0; i < prg_flags.size(); i++) if (prg_flags[i]) prg_used++;
+
+	printf("\n+--------+\n");
+	printf("|COVERAGE|\n");
+	printf("+--------+\n\n");
+	printf("CPU SPACE: %lu executed, %lu read, %lu written bytes\n", cpu[0], cpu[1], cpu[2]);
+	printf("PRG ROM:   %lu executed, %lu read, %lu of %lu bytes used (%.1f%%)\n", prg[0], prg[1],
+		prg_used, prg_flags.size(), prg_flags.empty() ? 0.0 : 100.0 * prg_used / prg_flags.size());
+}
+
+#endif // NES_COVERAGE
@@ -0,0 +1,53 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#ifdef NES_COVERAGE
+
+#include <string>
+
+#include "definitions.h"
+#include "cartridge.h"
+
+// Access flags. EXECUTE and READ double as the code and data bits of
+// FCEUX style CDL files so PRG coverage can be stored in that layout
+// as it is collected, PCM is the CDL bit for DMC sample fetches.
+namespace coverage {
+	const u8 EXECUTE = 0x01;
+	const u8 READ = 0x02;
+	const u8 WRITE = 0x04;
+	const u8 PCM = 0x40;
+};
+
+/*
+Bus coverage, only built with -DNES_COVERAGE (make COVERAGE=1). Memory
+ORs the access type into one byte per CPU address on every access and
+counts accesses per 256 byte page, the cartridge keeps the same per
+byte flags over physical PRG ROM (see Cartridge::markPRG).
+*/
+
+class Coverage {
+public:
+	Coverage();
+
+	void mark(u16 address, u8 access) {
+		flags[address] |= access;
+		page_accesses[address >> 8]++;
+	}
+
+	// Code/data log of the cartridge's PRG (and empty CHR) ROM
+	bool writeCDL(const std::string filename, Cartridge& cartridge);
+
+	// 256x256 PNG with one pixel per CPU address, red for executed, green
+	// for read and blue for written bytes, brighter on busier pages.
+	bool writeHeatmap(const std::string filename);
+
+	// Executed/read/written byte counts for CPU space and PRG ROM
+	void report(Cartridge& cartridge);
+private:
+	u8 flags[0x10000];
+	u64 page_accesses[0x100];
+};
+
+#endif // NES_COVERAGE
+
+#endif // COVERAGE_H
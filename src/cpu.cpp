@@ -1,7 +1,40 @@
 #include "cpu.h"
+#include "alu.h"
+#include "opcodes.h"
 
 CPU::CPU(Memory& memory) : memory(memory) {
+#ifdef NES_TABLE_ALU
+	alu::init();
+#endif
 	cpu_running = true;
+	cpu_cycles = 0;
+	loop_cycles = 0;
+	total_cycles = 0;
+	instructions = 0;
+
+	// Skipped passes would all be charged to the loop's backward branch
+#ifdef NES_PROFILER
+	idle_skip = false;
+#else
+	idle_skip = true;
+#endif
+	next_event = 0;
+	idle_head = idle_edge = 0;
+	idle_a = idle_x = idle_y = idle_p = idle_sp = 0;
+	idle_time = 0;
+	idle_instructions = 0;
+	idle_cycles = 0;
+	idle_skips = 0;
+	idle_loops.assign(0x8000, 0);
+
+	// Pairs would blur the profiler's per-instruction numbers
+#ifdef NES_PROFILER
+	fusion = false;
+#else
+	fusion = true;
+#endif
+	for (int i = 0; i < FUSION_COUNT; i++) fusion_hits[i] = 0;
+	recompiled = NULL;
 
 	printf("\n+----------------+\n");
 	printf("|STARTING NES CPU|\n");
@@ -20,44 +53,103 @@ CPU::CPU(Memory& memory) : memory(memory) {
 	u16 reset_vector = 0xC000;	// For NES test ROM
 	regPC.set(reset_vector);
 
-	// Don't really know how to test this nes CPU so I'm just going to compare
-	// the output with the log of a working emulator
+	// Games boot through reset() instead, the fixed $C000 start is only
+	// there to compare traces against the nestest log.
+	trace = false;
+}
+
+CPU::~CPU() {
 	
-	// This isn't a full while loop at the moment, I'm just trying to compare
-	// lines of code from my emulator's log to the log of a well-known working
-	// emulator to debug the CPU before going any further.
-	for (int i = 0; i < 3200; i++) {
-		if (cpu_cycles > 341) cpu_cycles -= 341;
-		u16 current_pc = regPC.value();
-		u8 opcode = get_byte_from_pc();
+}
+
+unsigned int CPU::tick() {
+	if (cpu_cycles > 341) cpu_cycles -= 341;
+	u16 current_pc = regPC.value();
+	u8 opcode = 0;
+	if (!run_recompiled()) {
+		opcode = get_byte_from_pc();
 
 		// Display debugging information
-		printf("%04X\t%02X\t%s\t\t\t", current_pc, opcode, opcode_names[opcode].c_str());
-		printf("A:%02X X:%02X Y:%02X P:%02X SP:%02X CYCLES:%lu\n", regA.value(), regX.value(), regY.value(), regStatus.value(), regSP.value(), cpu_cycles);
-		
-		// Execute the opcode (switch case)
+		if (trace) {
+			printf("%04X\t%02X\t%s\t\t\t", current_pc, opcode, opcodes::TABLE[opcode].mnemonic);
+			printf("A:%02X X:%02X Y:%02X P:%02X SP:%02X CYCLES:%lu\n", regA.value(), regX.value(), regY.value(), regStatus.value(), regSP.value(), cpu_cycles);
+		}
+
+		// Execute the opcode (switch case), fused pairs count their second
+		// instruction themselves
+		instructions++;
 		execute_opcode(opcode);
-		// Multiply loop_cycles by three because 1 ppu cycle is equal to
-		// 3 cpu cycles
-		cpu_cycles += loop_cycles*3;
-		// Reset loop cycles back to zero so that it does not interfere with the
-		// next executed opcode
-		loop_cycles = 0;
 	}
+
+	// A write to $4014 halts the CPU while OAM DMA runs, 513 cycles plus
+	// one more if the DMA starts on an odd CPU cycle.
+	if (memory.takeDMAStall())
+		loop_cycles += 513 + ((total_cycles + loop_cycles) & 1);
+
+	// DMC sample fetches steal a few cycles each. An idle loop pass that
+	// paid for some isn't like the others, the next one is measured again.
+	unsigned int dmc_stall = memory.getAPU().takeStallCycles();
+	if (dmc_stall) {
+		loop_cycles += dmc_stall;
+		idle_head = idle_edge = 0;
+	}
+
+	unsigned int cycles = loop_cycles;
+	total_cycles += cycles;
+#ifdef NES_PROFILER
+	profiler.record(current_pc, opcode, cycles);
+#endif
+	// Multiply loop_cycles by three because 1 ppu cycle is equal to
+	// 3 cpu cycles
+	cpu_cycles += cycles*3;
+	// Reset loop cycles back to zero so that it does not interfere with the
+	// next executed opcode
+	loop_cycles = 0;
+	return cycles;
 }
 
-CPU::~CPU() {
-	
+void CPU::reset() {
+	regSP.set(0xFD);
+	regStatus.set(0x24);
+	u8 lower = memory.readByte(0xFFFC);
+	u8 upper = memory.readByte(0xFFFD);
+	regPC.set(bitwise::combine_bytes(lower, upper));
+}
+
+void CPU::set_recompiled(const RecompiledBlock* table) {
+#if defined(NES_PROFILER) || defined(NES_COVERAGE)
+	if (table) printf("ERROR: Recompiled code isn't used in profiler or coverage builds!\n");
+#else
+	recompiled = table;
+#endif
+}
+
+void CPU::set_trace(bool on) {
+	trace = on;
 }
 
+unsigned long long CPU::get_total_cycles() {
+	return total_cycles;
+}
+
+unsigned long long CPU::get_instruction_count() {
+	return instructions;
+}
+
+#ifdef NES_PROFILER
+Profiler& CPU::get_profiler() {
+	return profiler;
+}
+#endif
+
 u8 CPU::get_byte_from_pc() {
-	u8 result = memory.readByte(regPC.value());
+	u8 result = memory.fetchByte(regPC.value());
 	regPC.increment();
 	return result;
 }
 
 r8 CPU::get_signed_byte_from_pc() {
-	r8 result = memory.readByte(regPC.value());
+	r8 result = memory.fetchByte(regPC.value());
 	regPC.increment();
 	return result;
 }
@@ -69,11 +161,7 @@ u16 CPU::get_word_from_pc() {
 }
 
 void CPU::set_flags_nz(u8 value) {
-	if (value == 0) regStatus.set_zero(true);
-	else regStatus.set_zero(false);
-
-	if ((value & 0x80) == 0x80) regStatus.set_negative(true);
-	else regStatus.set_negative(false);
+	regStatus.set_flags(alu::NZ, alu::selected::nz(value));
 }
 
 // Stack operations
@@ -143,7 +231,7 @@ void CPU::execute_opcode(u8 opcode) {
 		case 0xF9: SBC_F9(); break;
 
 		// CMP
-		case 0xC9: CMP_C9(); break;
+		case 0xC9: CMP_C9(); if (next_fusible() == 0x90) fuse_CMP_BCC(); break;
 		case 0xC5: CMP_C5(); break;
 		case 0xD5: CMP_D5(); break;
 		case 0xC1: CMP_C1(); break;
@@ -169,13 +257,13 @@ void CPU::execute_opcode(u8 opcode) {
 		case 0xDE: DEC_DE(); break;
 
 		// DEX
-		case 0xCA: DEX_CA(); break;
+		case 0xCA: DEX_CA(); if (next_fusible() == 0xD0) fuse_DEX_BNE(); break;
 
 		// DEY
 		case 0x88: DEY_88(); break;
 
 		// INC
-		case 0xE6: INC_E6(); break;
+		case 0xE6: INC_E6(); if (next_fusible() == 0xA5) fuse_INC_LDA(); break;
 		case 0xF6: INC_F6(); break;
 		case 0xEE: INC_EE(); break;
 		case 0xFE: INC_FE(); break;
@@ -216,12 +304,12 @@ void CPU::execute_opcode(u8 opcode) {
 
 		// LDA
 		case 0xA9: LDA_A9(); break;
-		case 0xA5: LDA_A5(); break;
+		case 0xA5: LDA_A5(); fuse_LDA_branch(next_fusible()); break;
 		case 0xB5: LDA_B5(); break;
 		case 0xA1: LDA_A1(); break;
 		case 0xB1: LDA_B1(); break;
 		case 0xAD: LDA_AD(); break;
-		case 0xBD: LDA_BD(); break;
+		case 0xBD: LDA_BD(); if (next_fusible() == 0x9D) fuse_LDA_STA(); break;
 		case 0xB9: LDA_B9(); break;
 
 		// STA
@@ -294,5 +382,16 @@ void CPU::execute_opcode(u8 opcode) {
 		case 0x78: SEI_78(); break;
 		case 0xB8: CLV_B8(); break;
 		case 0xEA: NOP_EA(); break;
+
+		// Unofficial opcodes aren't emulated yet. They fetch their operand
+		// bytes and take their usual time without doing anything else, so
+		// the code after them stays in step. Page crossing penalties and
+		// the STP/KIL hang aren't modelled.
+		default: {
+			const opcodes::Info& op = opcodes::TABLE[opcode];
+			for (int i = 1; i < op.length; i++) get_byte_from_pc();
+			loop_cycles += op.cycles;
+			break;
+		}
 	}
 }
\ No newline at end of file
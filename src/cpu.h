@@ -3,10 +3,12 @@
 
 #include <thread>
 #include <chrono>
+#include <vector>
 
 #include "definitions.h"
 #include "register.h"
 #include "memory.h"
+#include "profiler.h"
 
 namespace {
 	const long CPU_CLOCK_SPEED_HZ =	1789773;
@@ -14,6 +16,12 @@ namespace {
 	const long APU_CLOCK_SPEED_HZ =	1789773;
  }
 
+class CPU;
+
+// Recompiled code for a run of ROM (see recompiled_library.h), entered
+// with regPC at one of the addresses it was built for
+typedef void (*RecompiledBlock)(CPU& cpu);
+
 class CPU {
 public:
 
@@ -23,7 +31,59 @@ public:
 	/*
 	NES 6502 has a clock that runs at about 1.79MHz (1789773Hz)
 	*/
-	void tick();	// Emulates a single opcode execution
+	unsigned int tick();	// Emulates a single opcode execution, returns the cycles taken
+
+	// Jump to the reset vector ($FFFC) like a real power on
+	void reset();
+
+	// Print a nestest style log line for every executed opcode
+	void set_trace(bool on);
+
+	unsigned long long get_total_cycles();
+	unsigned long long get_instruction_count();	// Opcodes executed since power on
+
+	/*
+	Idle loop skipping (idle_loop.cpp). A short loop that only reads
+	fixed addresses and comes back around in exactly the same state will
+	spin until something outside the CPU changes what it reads, so the
+	clock jumps straight to the next such event instead of interpreting
+	every iteration. The owner sets that event as the last cycle an
+	instruction may start at before it, nothing is skipped past it.
+	*/
+	void set_idle_skip(bool on);
+	void set_next_event(unsigned long long cycle);
+	unsigned long long get_idle_cycles();	// Cycles skipped so far
+	unsigned long get_idle_skips();
+
+	/*
+	Superinstructions (fusion.cpp). Common pairs like DEX; BNE run as one
+	step of the interpreter, the second instruction is looked up in the
+	same tick and skips the opcode dispatch, tick bookkeeping and the
+	flag round trip. Cycles are the same as running them one by one, and
+	pairs only fuse while the second instruction would start before the
+	next event (set_next_event()).
+	*/
+	enum Fusion {
+		FUSION_DEX_BNE, FUSION_LDA_BNE, FUSION_LDA_BEQ, FUSION_CMP_BCC,
+		FUSION_INC_LDA, FUSION_LDA_STA, FUSION_COUNT
+	};
+	void set_fusion(bool on);
+	unsigned long long get_fusion_hits(Fusion fusion);
+	static const char* get_fusion_name(Fusion fusion);
+
+	/*
+	Ahead of time recompiled code (tools/recompiler.cpp), one entry per
+	ROM address $8000-$FFFF or NULL where the interpreter runs. Blocks run
+	until they reach code they weren't built for, an instruction they
+	leave to the interpreter, the next event or owed DMC stall cycles.
+	Not used while tracing or in profiler and coverage builds, which
+	count every fetch.
+	*/
+	void set_recompiled(const RecompiledBlock* table);
+
+#ifdef NES_PROFILER
+	Profiler& get_profiler();
+#endif
 
 	/*
 	Three general purpose 8-bit registers: A, X, and Y, with A being the accumulator
@@ -49,11 +109,73 @@ private:
 	// Timers and loop breaks
 	unsigned long cpu_cycles;
 	unsigned int loop_cycles;
+	unsigned long long total_cycles;	// Master clock, in CPU cycles
+	unsigned long long instructions;
 
 	bool cpu_running;
+	bool trace;
+
+	// Idle loop state, the loop and CPU state of the last backward jump
+	bool idle_skip;
+	unsigned long long next_event;
+	u16 idle_head, idle_edge;
+	u8 idle_a, idle_x, idle_y, idle_p, idle_sp;
+	unsigned long long idle_time;
+	unsigned long long idle_instructions;
+	unsigned long long idle_cycles;
+	unsigned long idle_skips;
+	std::vector<s8> idle_loops;	// Per ROM jump address, 0 unknown, -1 not idle, else its length
+
+	bool fusion;
+	unsigned long long fusion_hits[FUSION_COUNT];
+
+	const RecompiledBlock* recompiled;
+
+#ifdef NES_PROFILER
+	Profiler profiler;
+#endif
+
+	// Generated code calls the opcode handlers directly
+	friend struct Recompiled;
 
 	void execute_opcode(u8 opcode);
 
+	// Runs recompiled code at regPC, false if there is none or it left the
+	// first instruction to the interpreter
+	bool run_recompiled() {
+		if (recompiled == NULL || trace || regPC.value() < 0x8000) return false;
+		RecompiledBlock block = recompiled[regPC.value() - 0x8000];
+		if (block == NULL) return false;
+		unsigned long long first_instruction = instructions;
+		block(*this);
+		return instructions != first_instruction;
+	}
+
+	// Idle loops, ROM jumps already known not to be one return right away
+	void backward_jump(u16 edge, u16 head) {
+		if (edge >= 0x8000 && idle_loops[edge - 0x8000] < 0) return;
+		idle_jump(edge, head);
+	}
+	void idle_jump(u16 edge, u16 head);
+	int idle_loop_length(u16 head, u16 edge);
+
+	// Superinstructions, run right after the first instruction of a pair.
+	// next_fusible() is the next opcode, or -1 if nothing may be fused.
+	// DMC stall cycles owed by the first instruction are charged before
+	// the second one, so they end the pair too.
+	int next_fusible() {
+		u8 opcode;
+		if (!fusion || trace || total_cycles + loop_cycles > next_event) return -1;
+		if (memory.getAPU().hasStallCycles()) return -1;
+		return memory.peekByte(regPC.value(), opcode) ? opcode : -1;
+	}
+	void skip_from_pc(u16 bytes);
+	void fuse_DEX_BNE();
+	void fuse_LDA_branch(int next_opcode);
+	void fuse_CMP_BCC();
+	void fuse_INC_LDA();
+	void fuse_LDA_STA();
+
 	// Stack operations
 	u8 stack_pop();
 	void stack_push(u8 byte);
@@ -0,0 +1,380 @@
+#include "debugger.h"
+
+#ifdef NES_DEBUGGER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "cpu.h"
+#include "memory.h"
+
+namespace {
+	// Binary operator precedence levels, loosest first
+	const int EXPRESSION_LEVELS = 9;
+
+	bool parse_hex(const std::string& text, size_t& position, unsigned long& number) {
+		size_t start = position;
+		while (position < text.size() && isxdigit(static_cast<unsigned char>(text[position]))) position++;
+		if (position == start) return false;
+		number = strtoul(text.substr(start, position - start).c_str(), NULL, 16);
+		return true;
+	}
+
+	bool parse_address(const std::string& text, size_t& position, u16& address) {
+		if (position < text.size() && text[position] == '$') position++;
+		unsigned long number;
+		if (!parse_hex(text, position, number) || number > 0xFFFF) return false;
+		address = static_cast<u16>(number);
+		return true;
+	}
+
+	const char* access_name(u8 access) {
+		if (access == debug::EXECUTE) return "execute";
+		if (access == debug::READ) return "read";
+		return "write";
+	}
+}
+
+bool Expression::parse(const std::string text, std::string& error) {
+	this->text = text;
+	this->error = &error;
+	program.clear();
+	position = 0;
+
+	skipSpaces();
+	if (position == text.size()) return true;
+	if (!parseBinary(0)) return false;
+	skipSpaces();
+	if (position != text.size()) return fail("unexpected '" + text.substr(position) + "'");
+
+	size_t depth = 0;
+	for (const Token& token : program) {
+		if (token.op <= VALUE) depth++;
+		else if (token.op >= MUL) depth--;
+		if (depth > MAX_DEPTH) return fail("too deeply nested");
+	}
+	return true;
+}
+
+long Expression::evaluate(const Context& context) const {
+	if (program.empty()) return 1;
+
+	long stack[MAX_DEPTH];
+	size_t size = 0;
+	for (const Token& token : program) {
+		long right = 0;
+		switch (token.op) {
+			case PUSH: stack[size++] = token.value; continue;
+			case REG_A: stack[size++] = context.cpu.regA.value(); continue;
+			case REG_X: stack[size++] = context.cpu.regX.value(); continue;
+			case REG_Y: stack[size++] = context.cpu.regY.value(); continue;
+			case REG_P: stack[size++] = context.cpu.regStatus.value(); continue;
+			case REG_SP: stack[size++] = context.cpu.regSP.value(); continue;
+			case REG_PC: stack[size++] = context.cpu.regPC.value(); continue;
+			case ADDRESS: stack[size++] = context.address; continue;
+			case VALUE: stack[size++] = context.value; continue;
+			case PEEK: {
+				u8 byte;
+				stack[size - 1] = context.memory.peekByte(static_cast<u16>(stack[size - 1]), byte) ? byte : 0;
+				continue;
+			}
+			case NOT: stack[size - 1] = !stack[size - 1]; continue;
+			case COMPLEMENT: stack[size - 1] = ~stack[size - 1]; continue;
+			case NEGATE: stack[size - 1] = -stack[size - 1]; continue;
+			default:
+				right = stack[--size];
+				break;
+		}
+
+		long& left = stack[size - 1];
+		switch (token.op) {
+			case MUL: left *= right; break;
+			case DIV: left = right ? left / right : 0; break;
+			case MOD: left = right ? left % right : 0; break;
+			case ADD: left += right; break;
+			case SUB: left -= right; break;
+			case BIT_AND: left &= right; break;
+			case BIT_XOR: left ^= right; break;
+			case BIT_OR: left |= right; break;
+			case EQUAL: left = left == right; break;
+			case NOT_EQUAL: left = left != right; break;
+			case LESS: left = left < right; break;
+			case LESS_EQUAL: left = left <= right; break;
+			case GREATER: left = left > right; break;
+			case GREATER_EQUAL: left = left >= right; break;
+			case AND: left = left && right; break;
+			case OR: left = left || right; break;
+			default: break;
+		}
+	}
+	return stack[size - 1];
+}
+
+const std::string& Expression::getText() const {
+	return text;
+}
+
+bool Expression::parseBinary(int level) {
+	struct BinaryOperator {
+		const char* symbol;
+		int level;
+		Op op;
+	};
+	// Two character symbols before their one character prefixes
+	static const BinaryOperator OPERATORS[] = {
+		{"||", 0, OR}, {"&&", 1, AND}, {"|", 2, BIT_OR}, {"^", 3, BIT_XOR}, {"&", 4, BIT_AND},
+		{"==", 5, EQUAL}, {"!=", 5, NOT_EQUAL},
+		{"<=", 6, LESS_EQUAL}, {">=", 6, GREATER_EQUAL}, {"<", 6, LESS}, {">", 6, GREATER},
+		{"+", 7, ADD}, {"-", 7, SUB}, {"*", 8, MUL}, {"/", 8, DIV}, {"%", 8, MOD}
+	};
+
+	if (level == EXPRESSION_LEVELS) return parseUnary();
+	if (!parseBinary(level + 1)) return false;
+	while (true) {
+		skipSpaces();
+		const BinaryOperator* found = NULL;
+		for (const BinaryOperator& candidate : OPERATORS) {
+			if (candidate.level == level && match(candidate.symbol)) {
+				found = &candidate;
+				break;
+			}
+		}
+		if (found == NULL) return true;
+		if (!parseBinary(level + 1)) return false;
+		program.push_back({found->op, 0});
+	}
+}
+
+bool Expression::parseUnary() {
+	skipSpaces();
+	Op op;
+	if (match("!")) op = NOT;
+	else if (match("~")) op = COMPLEMENT;
+	else if (match("-")) op = NEGATE;
+	else return parsePrimary();
+
+	if (!parseUnary()) return false;
+	program.push_back({op, 0});
+	return true;
+}
+
+bool Expression::parsePrimary() {
+	skipSpaces();
+	if (position == text.size()) return fail("expression ends early");
+
+	if (match("(") || match("[")) {
+		bool peek = text[position - 1] == '[';
+		if (!parseBinary(0)) return false;
+		skipSpaces();
+		if (!match(peek ? "]" : ")")) return fail(peek ? "missing ']'" : "missing ')'");
+		if (peek) program.push_back({PEEK, 0});
+		return true;
+	}
+
+	char c = text[position];
+	if (c == '$' || isdigit(static_cast<unsigned char>(c))) {
+		unsigned long number;
+		if (c == '$' || (c == '0' && position + 1 < text.size() && tolower(text[position + 1]) == 'x')) {
+			position += c == '$' ? 1 : 2;
+			if (!parse_hex(text, position, number)) return fail("missing hex digits");
+		}
+		else {
+			size_t start = position;
+			while (position < text.size() && isdigit(static_cast<unsigned char>(text[position]))) position++;
+			number = strtoul(text.substr(start, position - start).c_str(), NULL, 10);
+		}
+		program.push_back({PUSH, static_cast<long>(number)});
+		return true;
+	}
+
+	if (isalpha(static_cast<unsigned char>(c))) {
+		size_t start = position;
+		while (position < text.size() && isalpha(static_cast<unsigned char>(text[position]))) position++;
+		std::string name = text.substr(start, position - start);
+		for (char& letter : name) letter = tolower(letter);
+
+		static const struct { const char* name; Op op; } NAMES[] = {
+			{"a", REG_A}, {"x", REG_X}, {"y", REG_Y}, {"p", REG_P}, {"sp", REG_SP}, {"pc", REG_PC},
+			{"address", ADDRESS}, {"value", VALUE}
+		};
+		for (const auto& entry : NAMES) {
+			if (name == entry.name) {
+				program.push_back({entry.op, 0});
+				return true;
+			}
+		}
+		return fail("unknown name '" + name + "'");
+	}
+
+	return fail(std::string("unexpected '") + c + "'");
+}
+
+// Consumes symbol if the text continues with it. A lone & or | is never
+// the first half of && or ||.
+bool Expression::match(const char* symbol) {
+	size_t length = strlen(symbol);
+	if (text.compare(position, length, symbol) != 0) return false;
+	if (length == 1 && (symbol[0] == '&' || symbol[0] == '|') &&
+		position + 1 < text.size() && text[position + 1] == symbol[0]) return false;
+	position += length;
+	return true;
+}
+
+void Expression::skipSpaces() {
+	while (position < text.size() && isspace(static_cast<unsigned char>(text[position]))) position++;
+}
+
+bool Expression::fail(const std::string message) {
+	*error = message;
+	return false;
+}
+
+Debugger::Debugger(CPU& cpu, Memory& memory) : cpu(cpu), memory(memory) {
+	next_id = 1;
+	memset(pages, 0, sizeof(pages));
+	memset(&last_hit, 0, sizeof(last_hit));
+	last_hit.breakpoint = -1;
+	stop_pending = false;
+	instruction_pc = 0;
+	memory.setDebugger(this, pages);
+}
+
+Debugger::~Debugger() {
+	memory.setDebugger(NULL, NULL);
+}
+
+int Debugger::addBreakpoint(u16 first, u16 last, u8 access, const std::string condition) {
+	Breakpoint breakpoint;
+	std::string error;
+	if (!breakpoint.condition.parse(condition, error)) {
+		printf("ERROR: Bad breakpoint condition \"%s\": %s!\n", condition.c_str(), error.c_str());
+		return -1;
+	}
+	if (first > last || (access & (debug::EXECUTE | debug::READ | debug::WRITE)) == 0) {
+		printf("ERROR: Bad breakpoint range or access!\n");
+		return -1;
+	}
+
+	breakpoint.id = next_id++;
+	breakpoint.first = first;
+	breakpoint.last = last;
+	breakpoint.access = access;
+	breakpoint.hits = 0;
+	breakpoints.push_back(breakpoint);
+	updatePages();
+	return breakpoint.id;
+}
+
+int Debugger::addBreakpoint(const std::string spec) {
+	size_t colon = spec.find(':');
+	u8 access = 0;
+	for (size_t i = 0; colon != std::string::npos && i < colon; i++) {
+		char kind = tolower(spec[i]);
+		if (kind == 'x') access |= debug::EXECUTE;
+		else if (kind == 'r') access |= debug::READ;
+		else if (kind == 'w') access |= debug::WRITE;
+		else access = 0xFF;
+	}
+
+	size_t position = colon + 1;
+	u16 first = 0, last = 0;
+	bool valid = colon != std::string::npos && access != 0 && access != 0xFF &&
+		parse_address(spec, position, first);
+	if (valid) last = first;
+	if (valid && position < spec.size() && spec[position] == '-') {
+		position++;
+		valid = parse_address(spec, position, last);
+	}
+
+	std::string condition;
+	if (valid && position < spec.size()) {
+		size_t keyword = spec.find_first_not_of(' ', position);
+		valid = keyword != position && keyword != std::string::npos && spec.compare(keyword, 3, "if ") == 0;
+		if (valid) condition = spec.substr(keyword + 3);
+	}
+
+	if (!valid) {
+		printf("ERROR: Bad breakpoint \"%s\", expected <x|r|w...>:<address>[-<address>][ if <condition>]!\n", spec.c_str());
+		return -1;
+	}
+	return addBreakpoint(first, last, access, condition);
+}
+
+bool Debugger::removeBreakpoint(int id) {
+	for (size_t i = 0; i < breakpoints.size(); i++) {
+		if (breakpoints[i].id != id) continue;
+		breakpoints.erase(breakpoints.begin() + i);
+		updatePages();
+		return true;
+	}
+	return false;
+}
+
+void Debugger::clearBreakpoints() {
+	breakpoints.clear();
+	updatePages();
+}
+
+const std::vector<Debugger::Breakpoint>& Debugger::getBreakpoints() {
+	return breakpoints;
+}
+
+void Debugger::checkAccess(u16 address, u8 value, u8 access) {
+	for (Breakpoint& breakpoint : breakpoints) {
+		if (!matches(breakpoint, address, value, access)) continue;
+		last_hit.pc = instruction_pc;
+		stop_pending = true;
+		return;
+	}
+}
+
+const Debugger::Hit& Debugger::getLastHit() {
+	return last_hit;
+}
+
+void Debugger::printHit() {
+	if (last_hit.breakpoint < 0) return;
+	printf("Breakpoint %d: %s $%04X = $%02X at $%04X  A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu\n",
+		last_hit.breakpoint, access_name(last_hit.access), last_hit.address, last_hit.value, last_hit.pc,
+		cpu.regA.value(), cpu.regX.value(), cpu.regY.value(), cpu.regStatus.value(), cpu.regSP.value(),
+		cpu.get_total_cycles());
+}
+
+bool Debugger::matchExecute(u16 pc) {
+	u8 opcode;
+	if (!memory.peekByte(pc, opcode)) opcode = 0;
+	for (Breakpoint& breakpoint : breakpoints) {
+		if (!matches(breakpoint, pc, opcode, debug::EXECUTE)) continue;
+		last_hit.pc = pc;
+		return true;
+	}
+	return false;
+}
+
+// Counts and records the hit if the breakpoint covers the access and its
+// condition holds
+bool Debugger::matches(Breakpoint& breakpoint, u16 address, u8 value, u8 access) {
+	if (!(breakpoint.access & access) || address < breakpoint.first || address > breakpoint.last) return false;
+	Expression::Context context = {cpu, memory, address, value};
+	if (!breakpoint.condition.evaluate(context)) return false;
+
+	breakpoint.hits++;
+	last_hit.breakpoint = breakpoint.id;
+	last_hit.access = access;
+	last_hit.address = address;
+	last_hit.value = value;
+	return true;
+}
+
+void Debugger::updatePages() {
+	memset(pages, 0, sizeof(pages));
+	for (const Breakpoint& breakpoint : breakpoints) {
+		for (unsigned int page = breakpoint.first >> 8; page <= static_cast<unsigned int>(breakpoint.last >> 8); page++)
+			pages[page] |= breakpoint.access;
+	}
+	memory.setDebugger(this, pages);
+}
+
+#endif // NES_DEBUGGER
@@ -0,0 +1,167 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#ifdef NES_DEBUGGER
+
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+
+class CPU;
+class Memory;
+
+// What a breakpoint watches, any combination
+namespace debug {
+	const u8 EXECUTE = 0x01;
+	const u8 READ = 0x02;
+	const u8 WRITE = 0x04;
+}
+
+/*
+Breakpoint conditions, C style integer expressions over the registers
+(a, x, y, p, sp, pc), the accessed address and value, memory ([expr]
+peeks RAM or PRG ROM, anything else reads 0) and numbers ($c000, 0xc000
+or 49152). Operators are ! ~ - * / % + - & ^ | == != < <= > >= && || with
+C precedence, names are case insensitive. Parsed once into postfix, an
+empty condition is always true. Evaluation doesn't allocate, nesting
+that needs more than MAX_DEPTH values at once is refused by parse().
+*/
+
+class Expression {
+public:
+	struct Context {
+		CPU& cpu;
+		Memory& memory;
+		u16 address;
+		u8 value;
+	};
+
+	// Returns false and sets error if text isn't a valid expression
+	bool parse(const std::string text, std::string& error);
+	long evaluate(const Context& context) const;
+
+	const std::string& getText() const;
+
+	static const size_t MAX_DEPTH = 32;
+private:
+	// Operands first, then unary and binary operators
+	enum Op : u8 {
+		PUSH, REG_A, REG_X, REG_Y, REG_P, REG_SP, REG_PC, ADDRESS, VALUE, PEEK,
+		NOT, COMPLEMENT, NEGATE, MUL, DIV, MOD, ADD, SUB, BIT_AND, BIT_XOR, BIT_OR,
+		EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, AND, OR
+	};
+	struct Token {
+		Op op;
+		long value;
+	};
+
+	std::string text;
+	std::vector<Token> program;
+
+	// Recursive descent parser state
+	size_t position;
+	std::string* error;
+
+	bool parseBinary(int level);
+	bool parseUnary();
+	bool parsePrimary();
+	bool match(const char* symbol);
+	void skipSpaces();
+	bool fail(const std::string message);
+};
+
+/*
+Execute, read and write breakpoints, only built with -DNES_DEBUGGER
+(make DEBUGGER=1). Every breakpoint marks the 256 byte pages it covers
+in a bitmap per access kind, Memory copies the read and write bits and
+tests nothing but its page's bit on each access, NES tests the execute
+bit before each instruction while a debugger is attached. Only a hit
+page goes through the breakpoint list and its conditions.
+
+Execute hits stop NES::step() and NES::run_cycles() before the
+instruction runs, read and write hits right after the instruction that
+made the access. NES::run_frame() prints hits and carries on.
+*/
+
+class Debugger {
+public:
+	struct Breakpoint {
+		int id;
+		u16 first, last;	// Inclusive range
+		u8 access;
+		Expression condition;
+		unsigned long hits;
+	};
+
+	struct Hit {
+		int breakpoint;	// Id, -1 if nothing has hit yet
+		u8 access;
+		u16 address;
+		u8 value;	// Read or written, the opcode for execute hits
+		u16 pc;	// Instruction that hit
+	};
+
+	Debugger(CPU& cpu, Memory& memory);
+	~Debugger();
+
+	// Watches first-last (inclusive) for the access kinds in access (debug::
+	// flags). Returns the new breakpoint's id, or -1 after printing the error
+	// if the condition doesn't parse.
+	int addBreakpoint(u16 first, u16 last, u8 access, const std::string condition = "");
+	// Same from text like "x:c000", "rw:0300-03ff" or "w:4014 if value != 2",
+	// access is any of x (execute), r and w.
+	int addBreakpoint(const std::string spec);
+	bool removeBreakpoint(int id);
+	void clearBreakpoints();
+	const std::vector<Breakpoint>& getBreakpoints();
+
+	// True while any breakpoint is set, see NES::run_frame()
+	bool isActive() {
+		return !breakpoints.empty();
+	}
+
+	// Execute breakpoints at pc, called before the instruction there runs.
+	// Only pages with an execute breakpoint look any further.
+	bool checkExecute(u16 pc) {
+		if (!(pages[pc >> 8] & debug::EXECUTE)) return false;
+		return matchExecute(pc);
+	}
+
+	// Called by Memory for accesses to pages with read or write breakpoints
+	void checkAccess(u16 address, u8 value, u8 access);
+
+	// The instruction about to run, for the hit's pc
+	void beginInstruction(u16 pc) {
+		instruction_pc = pc;
+	}
+
+	// Returns true (once) if a read or write breakpoint hit since the last call
+	bool takeStop() {
+		bool stop = stop_pending;
+		stop_pending = false;
+		return stop;
+	}
+
+	const Hit& getLastHit();
+	void printHit();
+private:
+	CPU& cpu;
+	Memory& memory;
+
+	std::vector<Breakpoint> breakpoints;
+	int next_id;
+	u8 pages[0x100];	// debug:: flags of the breakpoints on each page
+
+	Hit last_hit;
+	bool stop_pending;
+	u16 instruction_pc;
+
+	bool matchExecute(u16 pc);
+	bool matches(Breakpoint& breakpoint, u16 address, u8 value, u8 access);
+	void updatePages();
+};
+
+#endif // NES_DEBUGGER
+
+#endif // DEBUGGER_H
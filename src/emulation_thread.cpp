@@ -0,0 +1,139 @@
+#include "emulation_thread.h"
+
+#include <chrono>
+#include <stdio.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+	// 341 * 262 PPU dots per frame at three dots per CPU cycle
+	const double FRAME_SECONDS = 341.0 * 262.0 / 3.0 / CPU_CLOCK_SPEED_HZ;
+
+	// Give up catching up after falling this many frames behind (e.g.
+	// after the machine was suspended) and pace from now instead.
+	const int MAX_FRAMES_BEHIND = 4;
+
+	// Frames published per second when fast forwarding, and how often the
+	// skip ratio is adjusted to hold it.
+	const double PRESENT_FPS = 1.0 / FRAME_SECONDS;
+	const double STATS_SECONDS = 0.25;
+}
+
+EmulationThread::EmulationThread(NES& nes, TripleBuffer<Framebuffer>& frames) : nes(nes), frames(frames) {
+	running = false;
+	affinity = -1;
+	realtime = false;
+	speed = 1.0;
+	fps = 0.0;
+	frame_skip = 1;
+}
+
+EmulationThread::~EmulationThread() {
+	stop();
+}
+
+void EmulationThread::setAffinity(int cpu) {
+	affinity = cpu;
+}
+
+void EmulationThread::setRealtime(bool on) {
+	realtime = on;
+}
+
+void EmulationThread::setSpeed(double multiplier) {
+	speed = multiplier;
+}
+
+double EmulationThread::getSpeed() {
+	return speed;
+}
+
+double EmulationThread::getFPS() {
+	return fps;
+}
+
+unsigned int EmulationThread::getFrameSkip() {
+	return frame_skip;
+}
+
+void EmulationThread::start() {
+	if (running) return;
+	running = true;
+	thread = std::thread(&EmulationThread::run, this);
+}
+
+void EmulationThread::stop() {
+	running = false;
+	if (thread.joinable()) thread.join();
+}
+
+void EmulationThread::run() {
+	applyScheduling();
+
+	typedef std::chrono::steady_clock clock;
+	const std::chrono::duration<double> frame_time(FRAME_SECONDS);
+	clock::time_point next_frame = clock::now();
+	double current_speed = speed;
+
+	clock::time_point stats_start = next_frame;
+	unsigned long stats_frames = 0;
+	unsigned int skipped = 0;
+
+	while (running) {
+		// Only render the frames that will actually be published
+		bool render = ++skipped >= frame_skip;
+		nes.run_frame(render);
+		if (render) {
+			frames.getBack() = nes.getFramebuffer();
+			frames.publish();
+			skipped = 0;
+		}
+
+		// Pick a skip ratio that keeps published frames near real time
+		stats_frames++;
+		clock::time_point now = clock::now();
+		std::chrono::duration<double> elapsed = now - stats_start;
+		if (elapsed.count() >= STATS_SECONDS) {
+			double measured = stats_frames / elapsed.count();
+			unsigned int skip = static_cast<unsigned int>(measured / PRESENT_FPS + 0.5);
+			fps = measured;
+			frame_skip = skip > 1 ? skip : 1;
+			stats_start = now;
+			stats_frames = 0;
+		}
+
+		if (speed != current_speed) {
+			current_speed = speed;
+			next_frame = now;
+		}
+		if (current_speed <= 0.0) continue;	// Uncapped
+
+		next_frame += std::chrono::duration_cast<clock::duration>(frame_time / current_speed);
+		if (now > next_frame + std::chrono::duration_cast<clock::duration>(frame_time * MAX_FRAMES_BEHIND))
+			next_frame = now;
+		std::this_thread::sleep_until(next_frame);
+	}
+}
+
+void EmulationThread::applyScheduling() {
+#ifdef __linux__
+	if (affinity >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(affinity, &set);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+			printf("WARNING: Unable to pin the emulation thread to CPU %i\n", affinity);
+	}
+	if (realtime) {
+		sched_param param;
+		param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+			printf("WARNING: Unable to give the emulation thread real-time priority\n");
+	}
+#else
+	if (affinity >= 0 || realtime) printf("WARNING: Thread affinity and priority are only supported on Linux\n");
+#endif
+}
@@ -0,0 +1,59 @@
+#ifndef EMULATION_THREAD_H
+#define EMULATION_THREAD_H
+
+#include <atomic>
+#include <thread>
+
+#include "framebuffer.h"
+#include "nes.h"
+#include "triple_buffer.h"
+
+/*
+Runs the NES on its own thread, paced by a high resolution clock at the
+NTSC frame rate so emulation speed never depends on the host's vsync.
+Each finished frame is published into a triple buffer for the frontend
+to pick up whenever it is ready to present.
+
+When running faster than real time only about 60 frames a second are
+rendered and published, the rest are skipped and only cost core time.
+*/
+
+class EmulationThread {
+public:
+	EmulationThread(NES& nes, TripleBuffer<Framebuffer>& frames);
+	~EmulationThread();
+
+	// Optional scheduling tweaks, applied when the thread starts. A
+	// negative cpu leaves the affinity alone.
+	void setAffinity(int cpu);
+	void setRealtime(bool on);
+
+	// Speed as a multiple of real time, 0 runs uncapped
+	void setSpeed(double multiplier);
+	double getSpeed();
+
+	// Emulated frames per second and frames run per published frame,
+	// updated a few times a second.
+	double getFPS();
+	unsigned int getFrameSkip();
+
+	void start();
+	void stop();
+private:
+	NES& nes;
+	TripleBuffer<Framebuffer>& frames;
+	std::thread thread;
+	std::atomic<bool> running;
+
+	int affinity;
+	bool realtime;
+
+	std::atomic<double> speed;
+	std::atomic<double> fps;
+	std::atomic<unsigned int> frame_skip;
+
+	void run();
+	void applyScheduling();
+};
+
+#endif // EMULATION_THREAD_H
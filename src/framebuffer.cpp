@@ -0,0 +1,35 @@
+#include "framebuffer.h"
+
+Framebuffer::Framebuffer() {
+	for (int i = 0; i < WIDTH * HEIGHT; i++) indices[i] = 0x0F;	// Black
+	clear(0xFF000000);
+	frame_number = 0;
+}
+
+void Framebuffer::clear(u32 color) {
+	for (int i = 0; i < WIDTH * HEIGHT; i++) pixels[i] = color;
+}
+
+u16* Framebuffer::getIndices() {
+	return indices;
+}
+
+const u16* Framebuffer::getIndices() const {
+	return indices;
+}
+
+u32* Framebuffer::getPixels() {
+	return pixels;
+}
+
+const u32* Framebuffer::getPixels() const {
+	return pixels;
+}
+
+void Framebuffer::setFrameNumber(unsigned long frame) {
+	frame_number = frame;
+}
+
+unsigned long Framebuffer::getFrameNumber() const {
+	return frame_number;
+}
@@ -0,0 +1,38 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "definitions.h"
+
+/*
+In-memory picture of a single emulated frame. The PPU writes palette
+indices (bits 0-5 colour, bits 6-8 emphasis), these get converted into
+ARGB8888 pixels (the same format as the SDL frame texture) so frontends
+can upload or dump them without any further conversion.
+*/
+
+class Framebuffer {
+public:
+	static const int WIDTH = 256;
+	static const int HEIGHT = 240;
+
+	Framebuffer();
+
+	void clear(u32 color);
+
+	u16* getIndices();
+	const u16* getIndices() const;
+
+	u32* getPixels();
+	const u32* getPixels() const;
+
+	// Emulated frame this picture belongs to
+	void setFrameNumber(unsigned long frame);
+	unsigned long getFrameNumber() const;
+
+private:
+	u16 indices[WIDTH * HEIGHT];
+	u32 pixels[WIDTH * HEIGHT];
+	unsigned long frame_number;
+};
+
+#endif // FRAMEBUFFER_H
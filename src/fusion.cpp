@@ -0,0 +1,96 @@
+#include "cpu.h"
+#include "opcodes.h"
+
+namespace {
+	const char* FUSION_NAMES[CPU::FUSION_COUNT] = {
+		"DEX; BNE", "LDA zp; BNE", "LDA zp; BEQ", "CMP #imm; BCC",
+		"INC zp; LDA zp", "LDA abs,X; STA abs,X"
+	};
+
+	// APU and IO registers, accesses there are timed against the APU clock
+	// which only moves between ticks.
+	bool is_io_register(u16 address) {
+		return 0x4000 <= address && address <= 0x401F;
+	}
+}
+
+void CPU::set_fusion(bool on) {
+	fusion = on;
+}
+
+unsigned long long CPU::get_fusion_hits(Fusion fusion) {
+	return fusion_hits[fusion];
+}
+
+const char* CPU::get_fusion_name(Fusion fusion) {
+	return FUSION_NAMES[fusion];
+}
+
+// Steps over bytes the fused handler already knows, coverage builds still
+// count them as fetched.
+void CPU::skip_from_pc(u16 bytes) {
+#ifdef NES_COVERAGE
+	for (u16 i = 0; i < bytes; i++) get_byte_from_pc();
+#else
+	regPC.set(regPC.value() + bytes);
+#endif
+}
+
+void CPU::fuse_DEX_BNE() {
+	skip_from_pc(1);
+	instructions++;
+	fusion_hits[FUSION_DEX_BNE]++;
+	branch(regX.value() != 0);
+}
+
+void CPU::fuse_LDA_branch(int next_opcode) {
+	if (next_opcode != 0xD0 && next_opcode != 0xF0) return;
+	skip_from_pc(1);
+	instructions++;
+	if (next_opcode == 0xD0) {
+		fusion_hits[FUSION_LDA_BNE]++;
+		branch(regA.value() != 0);
+	}
+	else {
+		fusion_hits[FUSION_LDA_BEQ]++;
+		branch(regA.value() == 0);
+	}
+}
+
+void CPU::fuse_CMP_BCC() {
+	skip_from_pc(1);
+	instructions++;
+	fusion_hits[FUSION_CMP_BCC]++;
+	branch(!regStatus.get_carry());
+}
+
+// Only the INC $nn; LDA $nn form, the LDA takes the byte INC just wrote
+// straight from RAM instead of going back through the bus.
+void CPU::fuse_INC_LDA() {
+	u16 pc = regPC.value();
+	u8 address, operand;
+	if (!memory.peekByte(pc - 1, address) || !memory.peekByte(pc + 1, operand) || operand != address) return;
+	const opcodes::Info& lda = opcodes::TABLE[0xA5];
+	skip_from_pc(lda.length);
+	instructions++;
+	fusion_hits[FUSION_INC_LDA]++;
+	LDA(memory.getRAMPage(0)[address]);
+	loop_cycles += lda.cycles;
+}
+
+// Copy loops. Pairs touching the APU or IO registers run one by one so
+// those accesses keep their exact timing.
+void CPU::fuse_LDA_STA() {
+	u16 pc = regPC.value();
+	u8 load_low, load_high, store_low, store_high;
+	if (!memory.peekByte(pc - 2, load_low) || !memory.peekByte(pc - 1, load_high) ||
+		!memory.peekByte(pc + 1, store_low) || !memory.peekByte(pc + 2, store_high)) return;
+	u16 source = bitwise::combine_bytes(load_low, load_high) + regX.value();
+	u16 destination = bitwise::combine_bytes(store_low, store_high) + regX.value();
+	if (is_io_register(source) || is_io_register(destination)) return;
+
+	skip_from_pc(1);
+	instructions++;
+	fusion_hits[FUSION_LDA_STA]++;
+	STA_9D();
+}
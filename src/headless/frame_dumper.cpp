@@ -0,0 +1,35 @@
+#include "frame_dumper.h"
+
+#include <stdio.h>
+
+#include "../image_writer.h"
+
+FrameDumper::FrameDumper(const std::string prefix, DumpFormat format, unsigned int interval)
+	: prefix(prefix), format(format), interval(interval) {
+}
+
+bool FrameDumper::wants(unsigned long frame_number) {
+	return interval != 0 && frame_number % interval == 0;
+}
+
+void FrameDumper::frame(const u32* pixels, int width, int height, unsigned long frame_number) {
+	if (!wants(frame_number)) return;
+
+	char filename[32];
+	snprintf(filename, sizeof(filename), "_%06lu", frame_number);
+	std::string path = prefix + filename;
+
+	switch (format) {
+		case DumpFormat::PPM: image_writer::write_ppm(path + ".ppm", pixels, width, height); break;
+		case DumpFormat::PNG: image_writer::write_png(path + ".png", pixels, width, height); break;
+		case DumpFormat::RAW: image_writer::write_raw_rgba(path + ".rgba", pixels, width, height); break;
+	}
+}
+
+bool FrameDumper::parseFormat(const std::string& name, DumpFormat& format) {
+	if (name == "ppm") format = DumpFormat::PPM;
+	else if (name == "png") format = DumpFormat::PNG;
+	else if (name == "raw") format = DumpFormat::RAW;
+	else return false;
+	return true;
+}
@@ -0,0 +1,35 @@
+#ifndef FRAME_DUMPER_H
+#define FRAME_DUMPER_H
+
+#include <string>
+
+#include "../definitions.h"
+
+enum class DumpFormat {
+	PPM, PNG, RAW
+};
+
+/*
+Writes every Nth emulated frame to disk as <prefix>_<frame>.<ext>, used
+by the headless frontend in place of a window.
+*/
+
+class FrameDumper {
+public:
+	FrameDumper(const std::string prefix, DumpFormat format, unsigned int interval);
+
+	// True if the given frame will be dumped, frames that won't don't
+	// need to be rendered at all.
+	bool wants(unsigned long frame_number);
+
+	// Dumps the frame if it falls on the interval, pixels are ARGB8888
+	void frame(const u32* pixels, int width, int height, unsigned long frame_number);
+
+	static bool parseFormat(const std::string& name, DumpFormat& format);
+private:
+	std::string prefix;
+	DumpFormat format;
+	unsigned int interval;
+};
+
+#endif // FRAME_DUMPER_H
@@ -0,0 +1,167 @@
+#include "cpu.h"
+
+#include "opcodes.h"
+
+namespace {
+	// Longest loop body looked at, polling loops are a handful of bytes
+	const u16 IDLE_LOOP_MAX_BYTES = 32;
+
+	// What a loop body may contain. Only instructions whose result depends
+	// on nothing but the registers and a fixed address, no writes, no
+	// stack and no control flow besides the backward jump itself. Counting
+	// and shifting never come back to the same state, leaving them out
+	// keeps delay loops off the slow path.
+	constexpr const char* IDLE_IMPLIED[] = {
+		"TAX", "TAY", "TXA", "TYA", "TSX", "CLC", "SEC", "CLV", "CLD", "SED", "NOP"
+	};
+	constexpr const char* IDLE_READS[] = {	// Immediate, zero page or absolute
+		"LDA", "LDX", "LDY", "BIT", "CMP", "CPX", "CPY", "AND", "ORA", "EOR"
+	};
+
+	constexpr bool same_mnemonic(const char* a, const char* b) {
+		while (*a != 0 && *a == *b) {
+			a++;
+			b++;
+		}
+		return *a == *b;
+	}
+
+	template <size_t N>
+	constexpr bool contains(const char* const (&mnemonics)[N], const char* mnemonic) {
+		for (size_t i = 0; i < N; i++) {
+			if (same_mnemonic(mnemonics[i], mnemonic)) return true;
+		}
+		return false;
+	}
+
+	constexpr bool is_idle_op(const opcodes::Info& op) {
+		if (!op.official) return false;
+		switch (op.mode) {
+			case opcodes::IMP:
+				return contains(IDLE_IMPLIED, op.mnemonic);
+			case opcodes::IMM:
+			case opcodes::ZPG:
+			case opcodes::ABS:
+				return contains(IDLE_READS, op.mnemonic);
+			default:
+				return false;
+		}
+	}
+
+	// is_idle_op() of every opcode, worked out at compile time so the
+	// scan is a lookup per instruction
+	struct IdleOps {
+		bool allowed[0x100];
+
+		constexpr IdleOps() : allowed() {
+			for (int opcode = 0; opcode < 0x100; opcode++) {
+				allowed[opcode] = is_idle_op(opcodes::TABLE[opcode]);
+			}
+		}
+	};
+	constexpr IdleOps IDLE_OPS;
+
+	// Reads that change something or return something time dependent.
+	// PPUDATA moves the VRAM address, $4000-$401F is the APU, controllers
+	// and test registers. PPUSTATUS is fine, the vblank it waits for is
+	// an event.
+	bool has_read_side_effects(u16 address) {
+		if (0x2000 <= address && address <= 0x3FFF && (address & 0x7) == 0x7) return true;
+		return 0x4000 <= address && address <= 0x401F;
+	}
+}
+
+void CPU::set_idle_skip(bool on) {
+	idle_skip = on;
+}
+
+void CPU::set_next_event(unsigned long long cycle) {
+	next_event = cycle;
+}
+
+unsigned long long CPU::get_idle_cycles() {
+	return idle_cycles;
+}
+
+unsigned long CPU::get_idle_skips() {
+	return idle_skips;
+}
+
+// Called by taken branches and JMPs whose target (head) is at or before
+// the jump itself (edge), with the jump's cycles already counted. A pass
+// that owes DMC stall cycles isn't measured, tick() charges them after the
+// jump and forgets the loop.
+void CPU::idle_jump(u16 edge, u16 head) {
+	if (!idle_skip || trace || edge - head > IDLE_LOOP_MAX_BYTES) return;
+	if (memory.getAPU().hasStallCycles()) return;
+
+	int length = idle_loop_length(head, edge);
+	if (length == 0) return;
+
+	unsigned long long now = total_cycles + loop_cycles;
+	bool same_state = head == idle_head && edge == idle_edge &&
+		regA.value() == idle_a && regX.value() == idle_x && regY.value() == idle_y &&
+		regStatus.value() == idle_p && regSP.value() == idle_sp;
+
+	// Coming back around in the same state after exactly one pass through a
+	// straight line body means every further pass is the same too, until
+	// an event changes memory under it.
+	if (same_state && now < next_event) {
+		if (instructions - idle_instructions == static_cast<unsigned long long>(length)) {
+			unsigned long long period = now - idle_time;
+			unsigned long long passes = (next_event - now) / period;
+			if (passes > 0) {
+				loop_cycles += passes * period;
+				instructions += passes * length;
+				now += passes * period;
+				idle_cycles += passes * period;
+				idle_skips++;
+			}
+		}
+	}
+
+	idle_head = head;
+	idle_edge = edge;
+	idle_a = regA.value();
+	idle_x = regX.value();
+	idle_y = regY.value();
+	idle_p = regStatus.value();
+	idle_sp = regSP.value();
+	idle_time = now;
+	idle_instructions = instructions;
+}
+
+// Number of instructions in one pass (jump included) of the loop from
+// head to the jump at edge, or 0 if the loop might touch anything.
+// Loops in ROM can't change and are only looked at once, a jump in ROM
+// always has the same target.
+int CPU::idle_loop_length(u16 head, u16 edge) {
+	bool rom = head >= 0x8000;
+	if (rom) {
+		s8 cached = idle_loops[edge - 0x8000];
+		if (cached != 0) return cached > 0 ? cached : 0;
+	}
+
+	int length = 1;
+	u16 pc = head;
+	while (pc < edge && length > 0) {
+		u8 opcode, low, high;
+		if (!memory.peekByte(pc, opcode)) return 0;
+		const opcodes::Info& op = opcodes::TABLE[opcode];
+		if (!IDLE_OPS.allowed[opcode]) {
+			length = 0;
+			break;
+		}
+		if (op.mode == opcodes::ABS) {
+			if (!memory.peekByte(pc + 1, low) || !memory.peekByte(pc + 2, high)) return 0;
+			if (has_read_side_effects(bitwise::combine_bytes(low, high))) length = 0;
+		}
+		pc += op.length;
+		if (length > 0) length++;
+	}
+
+	// Operands running into the jump mean it was decoded out of step
+	if (pc != edge) length = 0;
+	if (rom) idle_loops[edge - 0x8000] = length > 0 ? length : -1;
+	return length;
+}
@@ -0,0 +1,126 @@
+#include "image_writer.h"
+
+#include <stdio.h>
+#include <vector>
+
+namespace {
+	// Unpack ARGB8888 pixels into a byte stream of RGB or RGBA components
+	std::vector<u8> unpack(const u32* pixels, int width, int height, bool alpha) {
+		std::vector<u8> bytes;
+		bytes.reserve(width * height * (alpha ? 4 : 3));
+		for (int i = 0; i < width * height; i++) {
+			bytes.push_back((pixels[i] >> 16) & 0xFF);
+			bytes.push_back((pixels[i] >> 8) & 0xFF);
+			bytes.push_back(pixels[i] & 0xFF);
+			if (alpha) bytes.push_back((pixels[i] >> 24) & 0xFF);
+		}
+		return bytes;
+	}
+
+	bool write_file(const std::string& filename, const std::vector<u8>& header, const std::vector<u8>& body) {
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (file == NULL) {
+			printf("ERROR: Unable to open %s for writing!\n", filename.c_str());
+			return false;
+		}
+		bool ok = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+			fwrite(body.data(), 1, body.size(), file) == body.size();
+		fclose(file);
+		return ok;
+	}
+
+	// PNG helpers
+	u32 crc_table[256];
+	bool crc_table_ready = false;
+
+	u32 crc32(const u8* bytes, size_t length, u32 crc = 0xFFFFFFFF) {
+		if (!crc_table_ready) {
+			for (u32 n = 0; n < 256; n++) {
+				u32 c = n;
+				for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+				crc_table[n] = c;
+			}
+			crc_table_ready = true;
+		}
+		for (size_t i = 0; i < length; i++) crc = crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+		return crc;
+	}
+
+	void put_u32(std::vector<u8>& out, u32 value) {
+		out.push_back(value >> 24);
+		out.push_back(value >> 16);
+		out.push_back(value >> 8);
+		out.push_back(value);
+	}
+
+	void put_chunk(std::vector<u8>& out, const char* type, const std::vector<u8>& data) {
+		put_u32(out, data.size());
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		put_u32(out, crc32(&out[start], out.size() - start) ^ 0xFFFFFFFF);
+	}
+}
+
+namespace image_writer {
+	extern bool write_ppm(const std::string& filename, const u32* pixels, int width, int height) {
+		char header[32];
+		int length = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+		return write_file(filename, std::vector<u8>(header, header + length), unpack(pixels, width, height, false));
+	}
+
+	extern bool write_png(const std::string& filename, const u32* pixels, int width, int height) {
+		// Scanlines are prefixed with filter type 0 (none)
+		std::vector<u8> rgba = unpack(pixels, width, height, true);
+		std::vector<u8> raw;
+		raw.reserve(rgba.size() + height);
+		for (int y = 0; y < height; y++) {
+			raw.push_back(0);
+			raw.insert(raw.end(), rgba.begin() + y * width * 4, rgba.begin() + (y + 1) * width * 4);
+		}
+
+		// zlib stream made of uncompressed deflate blocks, size matters less
+		// than not depending on zlib here.
+		std::vector<u8> zlib = { 0x78, 0x01 };
+		size_t offset = 0;
+		do {
+			size_t length = raw.size() - offset;
+			if (length > 0xFFFF) length = 0xFFFF;
+			bool final_block = offset + length == raw.size();
+			zlib.push_back(final_block ? 1 : 0);
+			zlib.push_back(length & 0xFF);
+			zlib.push_back(length >> 8);
+			zlib.push_back(~length & 0xFF);
+			zlib.push_back((~length >> 8) & 0xFF);
+			zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+			offset += length;
+		} while (offset < raw.size());
+
+		u32 a = 1, b = 0;
+		for (size_t i = 0; i < raw.size(); i++) {
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		put_u32(zlib, (b << 16) | a);
+
+		std::vector<u8> ihdr;
+		put_u32(ihdr, width);
+		put_u32(ihdr, height);
+		ihdr.push_back(8);	// Bit depth
+		ihdr.push_back(6);	// Colour type RGBA
+		ihdr.push_back(0);	// Compression
+		ihdr.push_back(0);	// Filter
+		ihdr.push_back(0);	// Interlace
+
+		std::vector<u8> header = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		std::vector<u8> body;
+		put_chunk(body, "IHDR", ihdr);
+		put_chunk(body, "IDAT", zlib);
+		put_chunk(body, "IEND", std::vector<u8>());
+		return write_file(filename, header, body);
+	}
+
+	extern bool write_raw_rgba(const std::string& filename, const u32* pixels, int width, int height) {
+		return write_file(filename, std::vector<u8>(), unpack(pixels, width, height, true));
+	}
+};
@@ -0,0 +1,19 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <string>
+
+#include "definitions.h"
+
+/*
+Minimal image file writers with no library dependencies. All of them
+take ARGB8888 pixels, the format used by Framebuffer.
+*/
+
+namespace image_writer {
+	extern bool write_ppm(const std::string& filename, const u32* pixels, int width, int height);
+	extern bool write_png(const std::string& filename, const u32* pixels, int width, int height);
+	extern bool write_raw_rgba(const std::string& filename, const u32* pixels, int width, int height);
+};
+
+#endif // IMAGE_WRITER_H
@@ -2,6 +2,7 @@
 #define JUMP_FLAG_CPP
 
 #include "cpu.h"
+#include "alu.h"
 
 // BRANCHES
 
@@ -12,6 +13,7 @@ void CPU::branch(bool condition) {
 	loop_cycles += 2;
 	
 	if (condition) {
+		u16 edge = regPC.value() - 1;
 		r8 byte = get_signed_byte_from_pc();
 		u16 before_page = 0xFF00 & regPC.value();
 		regPC.set(regPC.value() + byte);
@@ -21,6 +23,8 @@ void CPU::branch(bool condition) {
 		// Check if page is crossed, if so, add 2 more cycles
 		if (before_page != (0xFF00 & regPC.value()))
 			loop_cycles += 2;
+
+		if (regPC.value() <= edge) backward_jump(edge, regPC.value());
 	} else {
 		regPC.increment();
 	}
@@ -76,6 +80,9 @@ void CPU::JSR_20() {	// Absolute
 	memory.writeByte(upper_stack, 0x101+regSP.value());
 
 	regPC.set(address);	// Jump to the absolute address
+#ifdef NES_PROFILER
+	profiler.call(address);
+#endif
 }
 
 void CPU::RTS_60() {	// Implied
@@ -85,13 +92,18 @@ void CPU::RTS_60() {	// Implied
 
 	u16 return_address = (upper_byte << 8) | lower_byte;
 	regPC.set(return_address + 1);
+#ifdef NES_PROFILER
+	profiler.ret();
+#endif
 
 	loop_cycles += 6;
 }
 
 void CPU::JMP_4C() {	// Absolute
 	// Sets the pc value to whatever the proceding bytes are
+	u16 edge = regPC.value() - 1;
 	regPC.set(absolute(3));
+	if (regPC.value() <= edge) backward_jump(edge, regPC.value());
 }
 
 void CPU::JMP_6C() {	// Indirect (specific to this opcode apparently)
@@ -111,23 +123,17 @@ void CPU::BIT_24() {	// Zero-page
 	u8 byte = memory.readByte(zero_page(3));
 	u8 result = regA.value() & byte;
 
-	// Test zero using result
-	regStatus.set_zero(result == 0);
-
-	// Negative flag is equal to the value of byte (bit 7)
-	regStatus.set_negative(bitwise::check_bit(byte, 7));
-
-	// Overflow flag is equal to the 6th bit of byte
-	regStatus.set_overflow(bitwise::check_bit(byte, 6));
+	// Test zero using result, negative and overflow are bits 7 and 6 of byte
+	regStatus.set_flags(alu::NEGATIVE | alu::OVERFLOW | alu::ZERO,
+		(byte & (alu::NEGATIVE | alu::OVERFLOW)) | (alu::selected::nz(result) & alu::ZERO));
 }
 
 void CPU::BIT_2C() {	// Absolute
 	u8 byte = memory.readByte(absolute(4));
 	u8 result = regA.value() & byte;
 
-	regStatus.set_zero(result == 0);
-	regStatus.set_negative(bitwise::check_bit(byte, 7));
-	regStatus.set_overflow(bitwise::check_bit(byte, 6));
+	regStatus.set_flags(alu::NEGATIVE | alu::OVERFLOW | alu::ZERO,
+		(byte & (alu::NEGATIVE | alu::OVERFLOW)) | (alu::selected::nz(result) & alu::ZERO));
 }
 
 // CLC (CLEARS CARRY FLAG)
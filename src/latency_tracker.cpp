@@ -0,0 +1,132 @@
+#include "latency_tracker.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+	// FNV-1a over the palette indices, enough to tell frames apart
+	u64 hash_frame(const Framebuffer& framebuffer) {
+		const u16* indices = framebuffer.getIndices();
+		u64 hash = 0xCBF29CE484222325ULL;
+		for (int i = 0; i < Framebuffer::WIDTH * Framebuffer::HEIGHT; i += 4) {
+			u64 chunk;
+			memcpy(&chunk, indices + i, sizeof(chunk));
+			hash = (hash ^ chunk) * 0x100000001B3ULL;
+		}
+		return hash;
+	}
+
+	double percentile(std::vector<double> values, double p) {
+		if (values.empty()) return 0.0;
+		std::sort(values.begin(), values.end());
+		size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+		return values[index];
+	}
+}
+
+LatencyTracker::LatencyTracker() {
+	pending = false;
+	latch_time = -1;
+	latch_frame = 0;
+	current_frame = 0;
+	baseline_hash = 0;
+	has_baseline = false;
+	first_frame = 0;
+	dropped = 0;
+}
+
+void LatencyTracker::hostInput(clock::time_point time) {
+	if (pending.load(std::memory_order_acquire)) return;
+
+	// The presenter state is only ever touched from this same thread, both
+	// frontends poll input and present on one thread.
+	host_time = time;
+	latch_time.store(-1, std::memory_order_relaxed);
+	has_baseline = false;
+	first_frame = current_frame.load(std::memory_order_relaxed);
+	pending.store(true, std::memory_order_release);
+}
+
+void LatencyTracker::beginFrame(unsigned long frame) {
+	current_frame.store(frame, std::memory_order_relaxed);
+}
+
+void LatencyTracker::guestLatch() {
+	if (!pending.load(std::memory_order_acquire)) return;
+	if (latch_time.load(std::memory_order_relaxed) != -1) return;
+
+	std::chrono::nanoseconds elapsed = clock::now() - host_time;
+	latch_frame.store(current_frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	latch_time.store(elapsed.count(), std::memory_order_release);
+}
+
+void LatencyTracker::framePresented(const Framebuffer& framebuffer, clock::time_point time) {
+	if (!pending.load(std::memory_order_acquire)) return;
+
+	long long latched = latch_time.load(std::memory_order_acquire);
+	unsigned long frame = framebuffer.getFrameNumber();
+
+	// Frames from before the game saw the input are the picture to compare
+	// against.
+	if (latched == -1 || frame < latch_frame.load(std::memory_order_relaxed)) {
+		baseline_hash = hash_frame(framebuffer);
+		has_baseline = true;
+		if (frame > first_frame + TIMEOUT_FRAMES) {
+			dropped++;
+			pending.store(false, std::memory_order_release);
+		}
+		return;
+	}
+
+	u64 hash = hash_frame(framebuffer);
+	if (!has_baseline) {
+		baseline_hash = hash;
+		has_baseline = true;
+		return;
+	}
+
+	if (hash != baseline_hash) {
+		Sample sample;
+		sample.host_to_latch = latched / 1000000.0;
+		sample.host_to_photon = std::chrono::duration<double, std::milli>(time - host_time).count();
+		sample.frames = frame - latch_frame.load(std::memory_order_relaxed);
+		samples.push_back(sample);
+		pending.store(false, std::memory_order_release);
+	} else if (frame > latch_frame.load(std::memory_order_relaxed) + TIMEOUT_FRAMES) {
+		// The input never changed anything on screen
+		dropped++;
+		pending.store(false, std::memory_order_release);
+	}
+}
+
+void LatencyTracker::report() {
+	std::vector<double> latch, photon, frames;
+	for (size_t i = 0; i < samples.size(); i++) {
+		latch.push_back(samples[i].host_to_latch);
+		photon.push_back(samples[i].host_to_photon);
+		frames.push_back(samples[i].frames);
+	}
+
+	printf("\n+-------------+\n");
+	printf("|INPUT LATENCY|\n");
+	printf("+-------------+\n\n");
+	printf("EVENTS: %lu measured, %lu without visible effect\n", samples.size(), dropped);
+	if (samples.empty()) return;
+	printf("HOST TO $4016 LATCH: p50 %.2fms p99 %.2fms\n", percentile(latch, 0.5), percentile(latch, 0.99));
+	printf("HOST TO PHOTON:      p50 %.2fms p99 %.2fms\n", percentile(photon, 0.5), percentile(photon, 0.99));
+	printf("LATCH TO PHOTON:     p50 %.0f frames p99 %.0f frames\n", percentile(frames, 0.5), percentile(frames, 0.99));
+}
+
+bool LatencyTracker::exportCSV(const std::string filename) {
+	FILE* file = fopen(filename.c_str(), "w");
+	if (file == NULL) {
+		printf("ERROR: Unable to open %s for writing!\n", filename.c_str());
+		return false;
+	}
+	fprintf(file, "host_to_latch_ms,host_to_photon_ms,latch_to_photon_frames\n");
+	for (size_t i = 0; i < samples.size(); i++)
+		fprintf(file, "%.3f,%.3f,%lu\n", samples[i].host_to_latch, samples[i].host_to_photon, samples[i].frames);
+	fclose(file);
+	return true;
+}
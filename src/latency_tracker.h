@@ -0,0 +1,67 @@
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "framebuffer.h"
+
+/*
+Measures input-to-photon latency. One host input event is followed at a
+time through three points:
+  1. the host timestamp of the key down (or synthetic) event,
+  2. the emulated frame in which the game first latches the new state
+     through $4016,
+  3. the first presented frame from then on whose picture differs.
+Each step happens on a different thread (input, emulation, presenter) so
+the hand over is done with atomics.
+*/
+
+class LatencyTracker {
+public:
+	typedef std::chrono::steady_clock clock;
+
+	LatencyTracker();
+
+	// Input thread, ignored while an earlier event is still in flight
+	void hostInput(clock::time_point time);
+
+	// Emulation thread
+	void beginFrame(unsigned long frame);
+	void guestLatch();
+
+	// Presenter, right after the frame reached the screen (or disk)
+	void framePresented(const Framebuffer& framebuffer, clock::time_point time);
+
+	// p50/p99 summary on stdout, and every sample as CSV
+	void report();
+	bool exportCSV(const std::string filename);
+private:
+	// Events that never change the picture are dropped after this long
+	static const unsigned long TIMEOUT_FRAMES = 120;
+
+	struct Sample {
+		double host_to_latch;	// ms
+		double host_to_photon;	// ms
+		unsigned long frames;	// emulated frames from latch to photon
+	};
+
+	std::atomic<bool> pending;
+	clock::time_point host_time;
+	std::atomic<long long> latch_time;	// ns since host_time, -1 until latched
+	std::atomic<unsigned long> latch_frame;
+	std::atomic<unsigned long> current_frame;
+
+	// Presenter side state
+	u64 baseline_hash;
+	bool has_baseline;
+	unsigned long first_frame;
+
+	std::vector<Sample> samples;
+	unsigned long dropped;
+};
+
+#endif // LATENCY_TRACKER_H
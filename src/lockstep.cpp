@@ -0,0 +1,205 @@
+#include "lockstep.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <functional>
+
+namespace {
+	// Matching digests printed before the one that differs
+	const size_t TRACE_DIGESTS = 16;
+
+	bool same(const Lockstep::Digest& a, const Lockstep::Digest& b) {
+		return a.cycles == b.cycles && a.instructions == b.instructions &&
+			a.write_hash == b.write_hash && a.writes == b.writes && a.pc == b.pc &&
+			a.a == b.a && a.x == b.x && a.y == b.y && a.p == b.p && a.sp == b.sp;
+	}
+
+	// Ticks ending on the same cycle may have started at different
+	// instructions, only what they left behind has to match
+	bool same_state(const TickLog::Entry& a, const TickLog::Entry& b) {
+		return a.a == b.a && a.x == b.x && a.y == b.y && a.p == b.p && a.sp == b.sp;
+	}
+
+	void format_tick(char* text, size_t size, const TickLog::Entry& entry) {
+		snprintf(text, size, "CYC:%-10llu %04X %02X A:%02X X:%02X Y:%02X P:%02X SP:%02X",
+			entry.cycles, entry.pc, entry.opcode, entry.a, entry.x, entry.y, entry.p, entry.sp);
+	}
+
+	void print_digest(const char* name, const Lockstep::Digest& digest) {
+		printf("  %-9s CYC:%-10llu INS:%-9llu PC:%04X A:%02X X:%02X Y:%02X P:%02X SP:%02X writes:%u hash:%016llX\n",
+			name, digest.cycles, digest.instructions, digest.pc, digest.a, digest.x, digest.y, digest.p,
+			digest.sp, digest.writes, static_cast<unsigned long long>(digest.write_hash));
+	}
+}
+
+Lockstep::Core::Core(const std::string& rom) :
+	cartridge(rom), memory(cartridge), cpu(memory), nes(cpu, memory),
+	digests(QUEUE_DIGESTS), history(HISTORY), ticks(), tick_history(HISTORY) {
+	cpu.reset();
+}
+
+Lockstep::Lockstep(const std::string& rom) : reference(rom), candidate(rom), stopping(false) {
+	reference.cpu.set_idle_skip(false);
+	reference.cpu.set_fusion(false);
+}
+
+Lockstep::~Lockstep() {
+	stop();
+}
+
+Cartridge& Lockstep::getCartridge(Side side) {
+	return getCore(side).cartridge;
+}
+
+CPU& Lockstep::getCPU(Side side) {
+	return getCore(side).cpu;
+}
+
+Lockstep::Core& Lockstep::getCore(Side side) {
+	return side == REFERENCE ? reference : candidate;
+}
+
+bool Lockstep::run(unsigned long long cycles, unsigned long long interval) {
+	if (interval == 0) interval = 1;
+	size_t intervals = (cycles + interval - 1) / interval;
+	stopping = false;
+	reference.thread = std::thread(&Lockstep::runCore, this, std::ref(reference), cycles, interval);
+	candidate.thread = std::thread(&Lockstep::runCore, this, std::ref(candidate), cycles, interval);
+
+	// Recent matching digests, oldest first once it wraps
+	std::vector<Digest> matched;
+	matched.reserve(TRACE_DIGESTS);
+	for (size_t i = 0; i < intervals; i++) {
+		Digest expected, actual;
+		while (reference.digests.pop(&expected, 1) == 0) std::this_thread::yield();
+		while (candidate.digests.pop(&actual, 1) == 0) std::this_thread::yield();
+
+		if (!same(expected, actual)) {
+			stop();
+			dump(matched, expected, actual, i);
+			return false;
+		}
+		if (matched.size() == TRACE_DIGESTS) matched.erase(matched.begin());
+		matched.push_back(expected);
+	}
+	stop();
+
+	printf("Lockstep: %zu intervals of %llu cycles matched (%llu instructions)\n",
+		intervals, interval, matched.empty() ? 0ULL : matched.back().instructions);
+	return true;
+}
+
+// Core thread. Runs interval by interval to the first instruction boundary
+// at or past each checkpoint, waiting while its queue is full.
+void Lockstep::runCore(Core& core, unsigned long long cycles, unsigned long long interval) {
+	core.memory.setWriteLog(&core.writes);
+	core.nes.setTickLog(&core.ticks);
+	size_t intervals = (cycles + interval - 1) / interval;
+	for (size_t i = 0; i < intervals && !stopping; i++) {
+		unsigned long long checkpoint = (i + 1) * interval;
+		unsigned long long now = core.cpu.get_total_cycles();
+		if (now < checkpoint) core.nes.run_cycles(checkpoint - now);
+
+		Digest digest = makeDigest(core);
+		core.history[i % HISTORY].swap(core.writes);
+		core.writes.clear();
+		core.tick_history[i % HISTORY] = core.ticks;
+		while (core.digests.push(&digest, 1) == 0) {
+			if (stopping) break;
+			std::this_thread::yield();
+		}
+	}
+	core.memory.setWriteLog(NULL);
+	core.nes.setTickLog(NULL);
+}
+
+Lockstep::Digest Lockstep::makeDigest(Core& core) {
+	Digest digest;
+	CPU& cpu = core.cpu;
+	digest.cycles = cpu.get_total_cycles();
+	digest.instructions = cpu.get_instruction_count();
+	digest.pc = cpu.regPC.value();
+	digest.a = cpu.regA.value();
+	digest.x = cpu.regX.value();
+	digest.y = cpu.regY.value();
+	digest.p = cpu.regStatus.value();
+	digest.sp = cpu.regSP.value();
+	digest.writes = static_cast<u32>(core.writes.size());
+	digest.write_hash = 0xCBF29CE484222325ULL;
+	for (const BusWrite& write : core.writes) {
+		digest.write_hash = (digest.write_hash ^ (write.address >> 8)) * 0x100000001B3ULL;
+		digest.write_hash = (digest.write_hash ^ (write.address & 0xFF)) * 0x100000001B3ULL;
+		digest.write_hash = (digest.write_hash ^ write.value) * 0x100000001B3ULL;
+	}
+	return digest;
+}
+
+void Lockstep::stop() {
+	stopping = true;
+	if (reference.thread.joinable()) reference.thread.join();
+	if (candidate.thread.joinable()) candidate.thread.join();
+}
+
+// Both cores have stopped, their write history is safe to read
+void Lockstep::dump(const std::vector<Digest>& matched, const Digest& expected, const Digest& actual, size_t interval) {
+	printf("Lockstep: cores differ in interval %zu\n", interval);
+	printf("Last %zu matching digests:\n", matched.size());
+	for (const Digest& digest : matched) print_digest("both", digest);
+	printf("First difference:\n");
+	print_digest("reference", expected);
+	print_digest("candidate", actual);
+	dumpTicks(reference.tick_history[interval % HISTORY], candidate.tick_history[interval % HISTORY]);
+
+	const std::vector<BusWrite>& reference_writes = reference.history[interval % HISTORY];
+	const std::vector<BusWrite>& candidate_writes = candidate.history[interval % HISTORY];
+	printf("Writes in the interval (reference | candidate):\n");
+	for (size_t i = 0; i < reference_writes.size() || i < candidate_writes.size(); i++) {
+		char left[16] = "", right[16] = "";
+		if (i < reference_writes.size()) snprintf(left, sizeof(left), "$%04X=$%02X", reference_writes[i].address, reference_writes[i].value);
+		if (i < candidate_writes.size()) snprintf(right, sizeof(right), "$%04X=$%02X", candidate_writes[i].address, candidate_writes[i].value);
+		bool differs = i >= reference_writes.size() || i >= candidate_writes.size() ||
+			reference_writes[i].address != candidate_writes[i].address || reference_writes[i].value != candidate_writes[i].value;
+		printf("  %4zu  %-9s | %-9s%s\n", i, left, right, differs ? "  <--" : "");
+	}
+}
+
+// The last ticks before the checkpoint lined up by the clock after them,
+// from where both logs reach back to. A line with one side empty is
+// inside a longer tick of the other core (idle loop, fused pair or
+// recompiled block). Stops at the first line whose two sides differ.
+void Lockstep::dumpTicks(const TickLog& reference_ticks, const TickLog& candidate_ticks) {
+	size_t left_count = reference_ticks.count < TickLog::ENTRIES ? reference_ticks.count : TickLog::ENTRIES;
+	size_t right_count = candidate_ticks.count < TickLog::ENTRIES ? candidate_ticks.count : TickLog::ENTRIES;
+	const TickLog::Entry* left_entries[TickLog::ENTRIES];
+	const TickLog::Entry* right_entries[TickLog::ENTRIES];
+	for (size_t i = 0; i < left_count; i++)
+		left_entries[i] = &reference_ticks.entries[(reference_ticks.count - left_count + i) % TickLog::ENTRIES];
+	for (size_t i = 0; i < right_count; i++)
+		right_entries[i] = &candidate_ticks.entries[(candidate_ticks.count - right_count + i) % TickLog::ENTRIES];
+
+	size_t i = 0, j = 0;
+	if (left_count > 0 && right_count > 0) {
+		unsigned long long first = std::max(left_entries[0]->cycles, right_entries[0]->cycles);
+		while (i < left_count && left_entries[i]->cycles < first) i++;
+		while (j < right_count && right_entries[j]->cycles < first) j++;
+	}
+
+	printf("Last ticks before the checkpoint (reference | candidate):\n");
+	while (i < left_count || j < right_count) {
+		const TickLog::Entry* left = i < left_count ? left_entries[i] : NULL;
+		const TickLog::Entry* right = j < right_count ? right_entries[j] : NULL;
+		if (left && right && left->cycles != right->cycles) {
+			if (left->cycles < right->cycles) right = NULL;
+			else left = NULL;
+		}
+
+		char left_text[64] = "", right_text[64] = "";
+		if (left) format_tick(left_text, sizeof(left_text), *left);
+		if (right) format_tick(right_text, sizeof(right_text), *right);
+		bool differs = left && right && !same_state(*left, *right);
+		printf("  %-48s | %s%s\n", left_text, right_text, differs ? "  <--" : "");
+		if (differs) break;
+		if (left) i++;
+		if (right) j++;
+	}
+}
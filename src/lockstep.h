@@ -0,0 +1,98 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "definitions.h"
+#include "cartridge.h"
+#include "memory.h"
+#include "cpu.h"
+#include "nes.h"
+#include "ring_buffer.h"
+
+/*
+Differential testing of two CPU configurations without a golden log. A
+reference core (the plain interpreter, no idle skipping, fusion or
+recompiled code) and a candidate core configured like a normal run are
+built from the same ROM image and each run on their own thread. Every
+interval both stop at the first instruction boundary at or past the
+same cycle and push a digest of their registers, clock and the bus
+writes since the last one into a wait-free queue. The calling thread
+compares them in order, and on the first difference stops both cores
+and prints the recent matching digests, both digests, and both cores'
+last ticks and writes in the interval that differs. Each core has its
+own copy of the cartridge and memory.
+
+Checkpoints are in cycles rather than instructions because every
+shortcut stops at the next event (CPU::set_next_event()), but some of
+them can't stop at a given instruction count. Two cores that agree
+always reach the same boundary.
+*/
+
+class Lockstep {
+public:
+	enum Side {
+		REFERENCE, CANDIDATE
+	};
+
+	struct Digest {
+		unsigned long long cycles;
+		unsigned long long instructions;
+		u64 write_hash;	// FNV-1a of the interval's writes, address then value
+		u32 writes;
+		u16 pc;
+		u8 a, x, y, p, sp;
+	};
+
+	// Builds and resets both cores from the same iNES file
+	Lockstep(const std::string& rom);
+	~Lockstep();
+
+	// Everything about a core that can be configured before run(), the
+	// reference starts with all shortcuts off
+	Cartridge& getCartridge(Side side);
+	CPU& getCPU(Side side);
+
+	// Compares both cores every interval cycles until cycles have run or
+	// they differ. Returns true if they never did.
+	bool run(unsigned long long cycles, unsigned long long interval);
+private:
+	// Digests either core may run ahead of the comparison, and how many
+	// intervals of writes and ticks each keeps (more, so the one that
+	// differed is still there when the core stops)
+	static const size_t QUEUE_DIGESTS = 256;
+	static const size_t HISTORY = QUEUE_DIGESTS * 2;
+
+	struct Core {
+		Cartridge cartridge;
+		Memory memory;
+		CPU cpu;
+		NES nes;
+		RingBuffer<Digest> digests;
+		std::vector<BusWrite> writes;
+		std::vector<std::vector<BusWrite>> history;
+		TickLog ticks;
+		std::vector<TickLog> tick_history;	// ticks as each interval ended
+		std::thread thread;
+
+		Core(const std::string& rom);
+	};
+
+	// Held by value, the queues' indices are cache line aligned
+	Core reference;
+	Core candidate;
+	std::atomic<bool> stopping;
+
+	Core& getCore(Side side);
+
+	void runCore(Core& core, unsigned long long cycles, unsigned long long interval);
+	Digest makeDigest(Core& core);
+	void stop();
+	void dump(const std::vector<Digest>& matched, const Digest& expected, const Digest& actual, size_t interval);
+	void dumpTicks(const TickLog& reference_ticks, const TickLog& candidate_ticks);
+};
+
+#endif // LOCKSTEP_H
@@ -1,4 +1,5 @@
 #include "cpu.h"
+#include "alu.h"
 
 // ORA (OR FUNCTION ON ACCUMULATOR)
 
@@ -85,16 +86,11 @@ void CPU::EOR_59() {
 
 // ADC (Add M to A with carry)
 void CPU::ADC(s8 byte) {
-	s8 value = byte;
+	u8 value = byte;
 	u8 reg_value = regA.value();
-	u8 result = regA.value() + regStatus.get_carry() + value;
-
-	// Set flags
-	regStatus.set_overflow((reg_value ^ result) & (value ^ result) & 0x80);
-	unsigned int carry_check = reg_value + static_cast<u8>(value+regStatus.get_carry());
-	regStatus.set_carry(carry_check > 0xFF);
-	regA.set(result);
-	set_flags_nz(regA.value());
+	u8 carry = regStatus.get_carry();
+	regStatus.set_flags(alu::NVZC, alu::selected::adc(reg_value, value, carry));
+	regA.set(reg_value + value + carry);
 }
 
 void CPU::ADC_69() { ADC(get_byte_from_pc()); loop_cycles += 2; }
@@ -121,16 +117,12 @@ void CPU::ADC_79() {
 // SBC (Subtract M from A with borrow)
 
 void CPU::SBC(s8 byte) {
-	s8 value = byte ^ 0xFF;
+	// A - M - (1 - C) is A + ~M + C
+	u8 value = byte ^ 0xFF;
 	u8 reg_value = regA.value();
-	u8 result = regA.value() + value + regStatus.get_carry();
-
-	// Set flags
-	regStatus.set_overflow((reg_value ^ result) & (value ^ result) & 0x80);
-	unsigned int carry_check = u8(reg_value) + u8(value) + regStatus.get_carry();
-	regStatus.set_carry(carry_check > 0xFF);
-	regA.set(result);
-	set_flags_nz(regA.value());
+	u8 carry = regStatus.get_carry();
+	regStatus.set_flags(alu::NVZC, alu::selected::adc(reg_value, value, carry));
+	regA.set(reg_value + value + carry);
 }
 
 void CPU::SBC_E9() { SBC(get_byte_from_pc()); loop_cycles += 2; }
@@ -157,9 +149,7 @@ void CPU::SBC_F9() {
 // CMP (COMPARE M TO A)
 
 void CPU::CMP(u8 byte) {
-	u8 result = regA.value() - byte;
-	regStatus.set_carry(regA.value() >= byte);
-	set_flags_nz(result);
+	regStatus.set_flags(alu::NZC, alu::selected::compare(regA.value(), byte));
 }
 
 void CPU::CMP_C9() { CMP(get_byte_from_pc()); loop_cycles += 2; }
@@ -186,9 +176,7 @@ void CPU::CMP_D9() {
 // CPX (COMPARE X WITH M)
 
 void CPU::CPX(u8 byte) {
-	u8 result = regX.value() - byte;
-	regStatus.set_carry(regX.value() >= byte);
-	set_flags_nz(result);
+	regStatus.set_flags(alu::NZC, alu::selected::compare(regX.value(), byte));
 }
 
 void CPU::CPX_E0() { CPX(get_byte_from_pc()); loop_cycles += 2; }
@@ -198,9 +186,7 @@ void CPU::CPX_EC() { CPX(memory.readByte(absolute(4))); }
 // CPY (COMPARE M WITH Y)
 
 void CPU::CPY(u8 byte) {
-	u8 result = regY.value() - byte;
-	regStatus.set_carry(regY.value() >= byte);
-	set_flags_nz(result);
+	regStatus.set_flags(alu::NZC, alu::selected::compare(regY.value(), byte));
 }
 
 void CPU::CPY_C0() { CPY(get_byte_from_pc()); loop_cycles += 2; }
@@ -262,24 +248,19 @@ void CPU::INY_C8() {	// Implied
 
 // ASL (Shift M or A left one bit)
 void CPU::ASL_0A() {	// Implied (shift the accumulator)
-	// Set the carry flag if the 7th bit is set
+	// The 7th bit is shifted out into the carry
 	// 10000000 << 1 = 00000000 (that last one is carried)
-	if (regA.value() & 0x80) regStatus.set_carry(true);
-	else regStatus.set_carry(false);
-
-	// Shift the accumulator left by one
-	regA.set(regA.value() << 1);
-
-	set_flags_nz(regA.value());
-
+	u8 value = regA.value();
+	u8 result = value << 1;
+	regA.set(result);
+	regStatus.set_flags(alu::NZC, alu::selected::nz(result) | value >> 7);
 	loop_cycles += 2;
 }
 
 void CPU::ASL(u16 memory_address) {
-	u8 result = memory.readByte(memory_address);
-	regStatus.set_carry(result & 0x80);
-	result <<= 1;
-	set_flags_nz(result);
+	u8 value = memory.readByte(memory_address);
+	u8 result = value << 1;
+	regStatus.set_flags(alu::NZC, alu::selected::nz(result) | value >> 7);
 	memory.writeByte(result, memory_address);
 }
 
@@ -290,22 +271,18 @@ void CPU::ASL_1E() { ASL(absolute_x(7)); }
 
 // ROL (ROTATE A OR M LEFT)
 void CPU::ROL_2A() {	// Implied (accumulator)
-	bool newCarry = regA.value() & 0x80;
-
 	// Rotate bits left (multiply them by 2 and add carry)
-	u8 result = (regA.value() * 2) + regStatus.get_carry();
+	u8 value = regA.value();
+	u8 result = (value << 1) | regStatus.get_carry();
 	regA.set(result);
-
-	regStatus.set_carry(newCarry);
-	set_flags_nz(result);
+	regStatus.set_flags(alu::NZC, alu::selected::nz(result) | value >> 7);
 	loop_cycles += 2;
 }
 
 void CPU::ROL(u16 memory_address) {
-	u8 result = memory.readByte(memory_address);
-	regStatus.set_carry(result & 0x80);
-	result = (result * 2) + regStatus.get_carry();
-	set_flags_nz(result);
+	u8 value = memory.readByte(memory_address);
+	u8 result = (value << 1) | regStatus.get_carry();
+	regStatus.set_flags(alu::NZC, alu::selected::nz(result) | value >> 7);
 	memory.writeByte(result, memory_address);
 }
 
@@ -316,21 +293,17 @@ void CPU::ROL_3E() { ROL(absolute_x(7)); }
 
 // LSR (SHIFT A OR M RIGHT BY 1)
 void CPU::LSR_4A() {	// Implied (accumulator)
-	u8 result = regA.value();
-	if (result & 0x1) regStatus.set_carry(true);
-	else regStatus.set_carry(false);
-
-	regA.set(result >> 1);
-
-	set_flags_nz(regA.value());
+	u8 value = regA.value();
+	u8 result = value >> 1;
+	regA.set(result);
+	regStatus.set_flags(alu::NZC, alu::selected::nz(result) | (value & alu::CARRY));
 	loop_cycles += 2;
 }
 
 void CPU::LSR(u16 memory_address) {
-	u8 result = memory.readByte(memory_address);
-	regStatus.set_carry(result & 0x1);
-	result >>= 1;
-	set_flags_nz(result);
+	u8 value = memory.readByte(memory_address);
+	u8 result = value >> 1;
+	regStatus.set_flags(alu::NZC, alu::selected::nz(result) | (value & alu::CARRY));
 	memory.writeByte(result, memory_address);
 }
 
@@ -341,24 +314,17 @@ void CPU::LSR_5E() { LSR(absolute_x(7)); }
 
 // ROR (ROTATE M OR A RIGHT)
 void CPU::ROR_6A() {	// Implied (accumulator)
-	u8 result = regA.value();
-	bool newCarry = result & 0x1;
-
-	result = (result / 2) + (regStatus.get_carry() * 128);
-
+	u8 value = regA.value();
+	u8 result = (value >> 1) | regStatus.get_carry() << 7;
 	regA.set(result);
-
-	regStatus.set_carry(newCarry);
-	set_flags_nz(regA.value());
+	regStatus.set_flags(alu::NZC, alu::selected::nz(result) | (value & alu::CARRY));
 	loop_cycles += 2;
 }
 
 void CPU::ROR(u16 memory_address) {
-	u8 result = memory.readByte(memory_address);
-	bool newCarry = result & 0x1;
-	result = (result/2) + (regStatus.get_carry() * 128);
-	set_flags_nz(result);
-	regStatus.set_carry(newCarry);
+	u8 value = memory.readByte(memory_address);
+	u8 result = (value >> 1) | regStatus.get_carry() << 7;
+	regStatus.set_flags(alu::NZC, alu::selected::nz(result) | (value & alu::CARRY));
 	memory.writeByte(result, memory_address);
 }
 
@@ -1,21 +1,506 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 #include "cartridge.h"
 #include "memory.h"
 #include "cpu.h"
 #include "nes.h"
+#include "latency_tracker.h"
+#include "audio_recorder.h"
+#include "ntsc_filter.h"
+#include "scaler.h"
+#include "thread_pool.h"
+#include "movie.h"
+#include "throughput.h"
+#include "recompiled_library.h"
+#include "lockstep.h"
+
+#ifdef NES_HEADLESS
+#include "headless/frame_dumper.h"
+#else
+#include "emulation_thread.h"
+#include "triple_buffer.h"
+#include "sdl2-boilerplate/boilerplate.h"
+#endif
+
+namespace {
+	const unsigned int NESTEST_INSTRUCTIONS = 3200;
+	const unsigned long BENCH_WARMUP_FRAMES = 60;
+
+	// --lockstep runs for frames of about this many CPU cycles
+	const unsigned long LOCKSTEP_FRAMES = 600;
+	const unsigned long long LOCKSTEP_FRAME_CYCLES = 29781;
+
+#ifndef NES_HEADLESS
+	// Audio device buffer and the ring buffer between the emulation thread
+	// and the audio callback. Rate control keeps the ring half full, so
+	// the ring only needs room for a frame of samples plus some jitter on
+	// either side (about 20ms of latency in total).
+	const int AUDIO_SAMPLE_RATE = 48000;
+	const int AUDIO_BUFFER_SAMPLES = 256;
+	const size_t AUDIO_RING_SAMPLES = 2048;
+#endif
+
+	// How much idle loop skipping and superinstructions took off the
+	// interpreter's hands
+	void report_shortcuts(CPU& cpu) {
+		unsigned long long total = cpu.get_total_cycles();
+		printf("Idle loops: skipped %llu of %llu cycles (%.1f%%)\n", cpu.get_idle_cycles(), total,
+			total ? cpu.get_idle_cycles() * 100.0 / total : 0.0);
+
+		unsigned long long fused = 0;
+		for (int i = 0; i < CPU::FUSION_COUNT; i++) fused += cpu.get_fusion_hits(static_cast<CPU::Fusion>(i));
+		if (fused == 0) return;
+		printf("Fused pairs: %llu (%.1f%% of instructions)\n", fused, fused * 200.0 / cpu.get_instruction_count());
+		for (int i = 0; i < CPU::FUSION_COUNT; i++) {
+			CPU::Fusion fusion = static_cast<CPU::Fusion>(i);
+			printf("  %-22s %12llu\n", CPU::get_fusion_name(fusion), cpu.get_fusion_hits(fusion));
+		}
+	}
+
+	void usage() {
+		printf("Usage: nes [options] <rom>\n");
+		printf("  --nestest              Trace the first %u opcodes from $C000 (nestest log)\n", NESTEST_INSTRUCTIONS);
+		printf("  --palette <file>       Load a .pal file (64 or 512 RGB entries)\n");
+		printf("  --filter <name>        Upscaler: none, scale2x, scale3x, xbr2x, hq2x or hq3x (default none)\n");
+		printf("  --ntsc                 NTSC composite signal filter (before the upscaler)\n");
+		printf("  --ntsc-stable          Don't alternate the NTSC phase between frames\n");
+		printf("  --latency              Measure input to photon latency, reported on exit\n");
+		printf("  --latency-log <file>   Also write every latency sample as CSV\n");
+		printf("  --record-audio <file>  Record the APU output\n");
+		printf("  --record-format <fmt>  wav or raw 16-bit mono PCM (default wav)\n");
+		printf("  --record-rate <hz>     Recording sample rate (default the APU's rate)\n");
+		printf("  --resample <quality>   Recording resampler: low, medium or high (default medium)\n");
+		printf("  --bench-frames <n>     Run n frames with no video or audio and report throughput\n");
+		printf("  --bench-warmup <n>     Warm-up frames, reported separately (default %lu)\n", BENCH_WARMUP_FRAMES);
+		printf("  --movie <file>         Replay an FM2 input movie in --bench-frames mode\n");
+		printf("  --no-idle-skip         Interpret every iteration of idle polling loops\n");
+		printf("  --no-fusion            Run common instruction pairs one by one\n");
+		printf("  --recompiled <file>    Run the game's code built by nes-recompile\n");
+		printf("  --cheat <code>         Game Genie code or AAAA:VV[:CC] hex patch (repeatable)\n");
+		printf("  --lockstep <cycles>    Compare this configuration against the plain interpreter\n");
+		printf("                         every n cycles on two threads, report the first difference\n");
+		printf("  --lockstep-frames <n>  Frames to compare in --lockstep mode (default %lu)\n", LOCKSTEP_FRAMES);
+#ifdef NES_PROFILER
+		printf("  --profile <file>       Write the profiler report here instead of stdout\n");
+		printf("  --profile-stacks <file> Write collapsed call stacks for flamegraph.pl\n");
+#endif
+#ifdef NES_COVERAGE
+		printf("  --cdl <file>           Code/data log written on exit (default <rom>.cdl)\n");
+		printf("  --heatmap <file>       Also write a PNG heatmap of CPU space accesses\n");
+#endif
+#ifdef NES_DEBUGGER
+		printf("  --break <spec>         Print every hit of a breakpoint like x:c000, rw:0300-03ff\n");
+		printf("                         or \"w:4014 if value != 2\" (repeatable)\n");
+#endif
+#ifdef NES_HEADLESS
+		printf("  --frames <n>           Number of frames to run (default 600)\n");
+		printf("  --dump-interval <n>    Write every nth frame to disk (default 0, never)\n");
+		printf("  --dump-format <fmt>    ppm, png or raw (default ppm)\n");
+		printf("  --dump-prefix <path>   Dumped frame filename prefix (default frame)\n");
+		printf("  --synthetic-input <n>  Toggle A on controller 1 every n frames (implies --latency)\n");
+#else
+		printf("  --speed <x>            Emulation speed multiplier, 0 for uncapped (default 1)\n");
+		printf("                         Holding tab fast forwards uncapped\n");
+		printf("  --no-vsync             Present without waiting for the display's refresh\n");
+		printf("  --affinity <cpu>       Pin the emulation thread to a CPU\n");
+		printf("  --realtime             Run the emulation thread with real-time priority\n");
+		printf("  --no-audio             Don't open an audio device\n");
+		printf("  --audio-ring <n>       Audio ring buffer size in samples (default %lu)\n", static_cast<unsigned long>(AUDIO_RING_SAMPLES));
+		printf("  --no-rate-control      Don't adjust the audio rate to the ring buffer fill\n");
+#endif
+	}
+
+#ifndef NES_HEADLESS
+	// Keyboard layout for controller 1
+	const struct {
+		SDL_Scancode key;
+		u16 button;
+	} KEYMAP[] = {
+		{ SDL_SCANCODE_X, buttons::A },
+		{ SDL_SCANCODE_Z, buttons::B },
+		{ SDL_SCANCODE_RSHIFT, buttons::SELECT },
+		{ SDL_SCANCODE_RETURN, buttons::START },
+		{ SDL_SCANCODE_UP, buttons::UP },
+		{ SDL_SCANCODE_DOWN, buttons::DOWN },
+		{ SDL_SCANCODE_LEFT, buttons::LEFT },
+		{ SDL_SCANCODE_RIGHT, buttons::RIGHT },
+	};
+
+	u16 held_buttons(Input& input) {
+		u16 held = 0;
+		for (size_t i = 0; i < sizeof(KEYMAP) / sizeof(KEYMAP[0]); i++)
+			if (input.wasKeyHeld(KEYMAP[i].key)) held |= KEYMAP[i].button;
+		return held;
+	}
+#endif
+}
 
 int main(int argc, char **argv) {
-	if (argc != 2)  {
-		printf("Usage: nes <rom>\n");
+	const char* rom = NULL;
+	const char* palette = NULL;
+	bool nestest = false;
+	ScaleFilter filter = ScaleFilter::NONE;
+	bool ntsc = false;
+	bool ntsc_alternate = true;
+	bool latency = false;
+	const char* latency_log = NULL;
+	const char* record_audio = NULL;
+	AudioFormat record_format = AudioFormat::WAV;
+	unsigned int record_rate = 0;
+	ResampleQuality resample_quality = ResampleQuality::MEDIUM;
+	unsigned long bench_frames = 0;
+	unsigned long bench_warmup = BENCH_WARMUP_FRAMES;
+	const char* movie_file = NULL;
+	bool idle_skip = true;
+	bool fusion = true;
+	const char* recompiled = NULL;
+	std::vector<std::string> cheats;
+	unsigned long long lockstep_interval = 0;
+	unsigned long lockstep_frames = LOCKSTEP_FRAMES;
+#ifdef NES_PROFILER
+	const char* profile_report = NULL;
+	const char* profile_stacks = NULL;
+#endif
+#ifdef NES_COVERAGE
+	const char* cdl = NULL;
+	const char* heatmap = NULL;
+#endif
+#ifdef NES_DEBUGGER
+	std::vector<std::string> breakpoints;
+#endif
+#ifdef NES_HEADLESS
+	unsigned long frames = 600;
+	unsigned int dump_interval = 0;
+	DumpFormat dump_format = DumpFormat::PPM;
+	std::string dump_prefix = "frame";
+	unsigned long synthetic_input = 0;
+#else
+	double speed = 1.0;
+	bool vsync = true;
+	int affinity = -1;
+	bool realtime = false;
+	bool audio_enabled = true;
+	size_t audio_ring = AUDIO_RING_SAMPLES;
+	bool rate_control = true;
+#endif
+
+	for (int i = 1; i < argc; i++) {
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--nestest") == 0) nestest = true;
+		else if (strcmp(argv[i], "--palette") == 0 && has_value) palette = argv[++i];
+		else if (strcmp(argv[i], "--ntsc") == 0) ntsc = true;
+		else if (strcmp(argv[i], "--ntsc-stable") == 0) ntsc_alternate = false;
+		else if (strcmp(argv[i], "--latency") == 0) latency = true;
+		else if (strcmp(argv[i], "--latency-log") == 0 && has_value) {
+			latency = true;
+			latency_log = argv[++i];
+		}
+		else if (strcmp(argv[i], "--record-audio") == 0 && has_value) record_audio = argv[++i];
+		else if (strcmp(argv[i], "--record-rate") == 0 && has_value) record_rate = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--record-format") == 0 && has_value) {
+			if (!AudioRecorder::parseFormat(argv[++i], record_format)) {
+				usage();
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--resample") == 0 && has_value) {
+			if (!Resampler::parseQuality(argv[++i], resample_quality)) {
+				usage();
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-frames") == 0 && has_value) bench_frames = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--bench-warmup") == 0 && has_value) bench_warmup = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--movie") == 0 && has_value) movie_file = argv[++i];
+		else if (strcmp(argv[i], "--no-idle-skip") == 0) idle_skip = false;
+		else if (strcmp(argv[i], "--no-fusion") == 0) fusion = false;
+		else if (strcmp(argv[i], "--recompiled") == 0 && has_value) recompiled = argv[++i];
+		else if (strcmp(argv[i], "--cheat") == 0 && has_value) cheats.push_back(argv[++i]);
+		else if (strcmp(argv[i], "--lockstep") == 0 && has_value) lockstep_interval = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--lockstep-frames") == 0 && has_value) lockstep_frames = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--filter") == 0 && has_value) {
+			if (!Scaler::parseFilter(argv[++i], filter)) {
+				usage();
+				return -1;
+			}
+		}
+#ifdef NES_PROFILER
+		else if (strcmp(argv[i], "--profile") == 0 && has_value) profile_report = argv[++i];
+		else if (strcmp(argv[i], "--profile-stacks") == 0 && has_value) profile_stacks = argv[++i];
+#endif
+#ifdef NES_COVERAGE
+		else if (strcmp(argv[i], "--cdl") == 0 && has_value) cdl = argv[++i];
+		else if (strcmp(argv[i], "--heatmap") == 0 && has_value) heatmap = argv[++i];
+#endif
+#ifdef NES_DEBUGGER
+		else if (strcmp(argv[i], "--break") == 0 && has_value) breakpoints.push_back(argv[++i]);
+#endif
+#ifdef NES_HEADLESS
+		else if (strcmp(argv[i], "--frames") == 0 && has_value) frames = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--dump-interval") == 0 && has_value) dump_interval = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--dump-prefix") == 0 && has_value) dump_prefix = argv[++i];
+		else if (strcmp(argv[i], "--synthetic-input") == 0 && has_value) {
+			latency = true;
+			synthetic_input = strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--dump-format") == 0 && has_value) {
+			if (!FrameDumper::parseFormat(argv[++i], dump_format)) {
+				usage();
+				return -1;
+			}
+		}
+#else
+		else if (strcmp(argv[i], "--speed") == 0 && has_value) speed = atof(argv[++i]);
+		else if (strcmp(argv[i], "--no-vsync") == 0) vsync = false;
+		else if (strcmp(argv[i], "--affinity") == 0 && has_value) affinity = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--realtime") == 0) realtime = true;
+		else if (strcmp(argv[i], "--no-audio") == 0) audio_enabled = false;
+		else if (strcmp(argv[i], "--audio-ring") == 0 && has_value) audio_ring = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--no-rate-control") == 0) rate_control = false;
+#endif
+		else if (argv[i][0] != '-' && rom == NULL) rom = argv[i];
+		else {
+			usage();
+			return -1;
+		}
+	}
+
+	if (rom == NULL)  {
+		usage();
 		return -1;
 	}
 
+	std::vector<Cheat> cheat_codes;
+	for (const std::string& code : cheats) {
+		Cheat cheat;
+		if (!Cheat::parse(code, cheat)) {
+			printf("ERROR: Bad cheat code %s!\n", code.c_str());
+			return -1;
+		}
+		cheat_codes.push_back(cheat);
+	}
+
 	// Initialize all NES components
-	Cartridge cartridge = Cartridge(argv[1]);
-	Memory memory = Memory(cartridge);
-	CPU cpu = CPU(memory);
-	NES nes = NES(cpu, memory);
+	Cartridge cartridge(rom);
+	for (const Cheat& cheat : cheat_codes) cartridge.addCheat(cheat);
+	Memory memory(cartridge);
+	CPU cpu(memory);
+	NES nes(cpu, memory);
+
+	if (nestest) {
+		// Compare these lines with the log of a well-known working emulator
+		memory.setLogging(true);
+		cpu.set_trace(true);
+		for (unsigned int i = 0; i < NESTEST_INSTRUCTIONS; i++) cpu.tick();
+		return 0;
+	}
+
+	if (palette && !nes.getPalette().load(palette)) return -1;
+	cpu.reset();
+	// Profiler builds have both off already
+	if (!idle_skip) cpu.set_idle_skip(false);
+	if (!fusion) cpu.set_fusion(false);
+	RecompiledLibrary library;
+	if (recompiled) {
+		if (!library.load(recompiled, cartridge)) return -1;
+		cpu.set_recompiled(library.getTable());
+		printf("Loaded %u recompiled entry points from %s\n", library.getEntryCount(), recompiled);
+	}
+#ifdef NES_DEBUGGER
+	Debugger debugger(cpu, memory);
+	for (const std::string& spec : breakpoints) {
+		if (debugger.addBreakpoint(spec) < 0) return -1;
+	}
+	if (!breakpoints.empty()) nes.setDebugger(&debugger);
+#endif
+
+	if (lockstep_interval) {
+		// The candidate runs with the shortcuts configured above
+		Lockstep lockstep(rom);
+		for (const Cheat& cheat : cheat_codes) {
+			lockstep.getCartridge(Lockstep::REFERENCE).addCheat(cheat);
+			lockstep.getCartridge(Lockstep::CANDIDATE).addCheat(cheat);
+		}
+		CPU& candidate = lockstep.getCPU(Lockstep::CANDIDATE);
+		if (!idle_skip) candidate.set_idle_skip(false);
+		if (!fusion) candidate.set_fusion(false);
+		if (recompiled) candidate.set_recompiled(library.getTable());
+		return lockstep.run(LOCKSTEP_FRAME_CYCLES * lockstep_frames, lockstep_interval) ? 0 : 1;
+	}
+
+	if (bench_frames) {
+		// Everything up to here is startup and isn't timed
+		Movie movie;
+		if (movie_file && !movie.load(movie_file)) return -1;
+		Throughput throughput(nes, cpu, memory);
+		if (movie_file) throughput.setMovie(&movie);
+		throughput.run(bench_warmup, bench_frames);
+		throughput.report();
+		report_shortcuts(cpu);
+		return 0;
+	}
+
+	LatencyTracker tracker;
+	if (latency) nes.setLatencyTracker(&tracker);
+
+	ThreadPool pool;
+	NTSCFilter ntsc_filter(pool);
+	ntsc_filter.setPhaseAlternation(ntsc_alternate);
+	Scaler scaler(pool);
+	scaler.setFilter(filter);
+
+	// NTSC output is twice as wide, and is shown at twice the height to
+	// keep the aspect ratio.
+	int filtered_width = Framebuffer::WIDTH * (ntsc ? NTSCFilter::OUTPUT_SCALE : 1);
+	int output_width = filtered_width * scaler.getScale();
+	int output_height = Framebuffer::HEIGHT * scaler.getScale();
+
+	// Runs the frame through the enabled filters and returns the pixels to
+	// show, keeps track of the time spent filtering.
+	double filter_time = 0.0;
+	auto filter_frame = [&](const Framebuffer& framebuffer) {
+		const u32* pixels = framebuffer.getPixels();
+		double time = 0.0;
+		if (ntsc) {
+			pixels = ntsc_filter.apply(framebuffer.getIndices(), Framebuffer::WIDTH, Framebuffer::HEIGHT);
+			time += ntsc_filter.getFilterTime();
+		}
+		pixels = scaler.apply(pixels, filtered_width, Framebuffer::HEIGHT);
+		time += scaler.getFilterTime();
+		filter_time += time;
+		return pixels;
+	};
+
+	// Opened once the APU's output rate is final
+	std::unique_ptr<AudioRecorder> recorder;
+	auto start_recording = [&]() {
+		if (record_audio == NULL) return;
+		APU& apu = memory.getAPU();
+		unsigned int rate = record_rate ? record_rate : apu.getSampleRate();
+		recorder.reset(new AudioRecorder(record_audio, record_format, apu.getSampleRate(), rate, resample_quality));
+		if (recorder->isOpen()) apu.setRecorder(recorder.get());
+	};
+
+#ifdef NES_HEADLESS
+	start_recording();
+	FrameDumper dumper(dump_prefix, dump_format, dump_interval);
+	unsigned long rendered = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	u16 synthetic_buttons = 0;
+	for (unsigned long i = 0; i < frames; i++) {
+		if (synthetic_input && i % synthetic_input == 0) {
+			synthetic_buttons ^= buttons::A;
+			memory.getController(0).setButtons(synthetic_buttons);
+			tracker.hostInput(LatencyTracker::clock::now());
+		}
+
+		// Frames that aren't dumped are never converted or filtered
+		bool dump = dumper.wants(nes.getFrameCount() + 1);
+		nes.run_frame(dump);
+		if (latency) tracker.framePresented(nes.getFramebuffer(), LatencyTracker::clock::now());
+		if (!dump) continue;
+		dumper.frame(filter_frame(nes.getFramebuffer()), output_width, output_height, nes.getFrameCount());
+		rendered++;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	printf("Ran %lu frames in %.3fs (%.1f fps)\n", frames, elapsed.count(), frames / elapsed.count());
+	if ((ntsc || filter != ScaleFilter::NONE) && rendered > 0)
+		printf("Filter time: %.3fms/frame on %u threads\n", filter_time / rendered, pool.getThreadCount());
+#else
+	Graphics graphics("NES", output_width, output_height * (ntsc ? 2 : 1), vsync);
+	graphics.createFrameTexture(output_width, output_height);
+	Input input;
+	SDL_Event event;
+	char overlay[192];
+
+	// Emulation runs and paces itself on its own thread, this one only
+	// handles input and presents the newest finished frame.
+	TripleBuffer<Framebuffer> frames;
+	EmulationThread emulation(nes, frames);
+
+	// The APU pushes every frame's samples, the audio callback pops them
+	RingBuffer<s16> audio_samples(audio_ring);
+	std::unique_ptr<Audio> audio;
+	if (audio_enabled) audio.reset(new Audio(audio_samples, AUDIO_SAMPLE_RATE, AUDIO_BUFFER_SAMPLES));
+	if (audio && audio->isOpen()) {
+		memory.getAPU().setSampleRate(audio->getSampleRate());
+		memory.getAPU().setOutput(&audio_samples);
+		memory.getAPU().getRateControl().setEnabled(rate_control);
+		audio->pause(false);
+	}
+	start_recording();
+
+	emulation.setAffinity(affinity);
+	emulation.setRealtime(realtime);
+	emulation.setSpeed(speed);
+	emulation.start();
+
+	while (true) {
+		input.beginNewFrame();
+		input.pollEvents(event);
+		if (input.wasKeyPressed(SDL_SCANCODE_ESCAPE)) break;
+
+		// Picked up by the emulation thread when the game strobes $4016
+		u16 held = held_buttons(input);
+		if (latency && (held & ~memory.getController(0).getButtons()))
+			tracker.hostInput(input.getLastKeyDownTime());
+		memory.getController(0).setButtons(held);
+		emulation.setSpeed(input.wasKeyHeld(SDL_SCANCODE_TAB) ? 0.0 : speed);
+
+		if (!frames.update()) {
+			SDL_Delay(1);
+			continue;
+		}
+
+		filter_time = 0.0;
+		const u32* pixels = filter_frame(frames.getFront());
+		int length = snprintf(overlay, sizeof(overlay), "filter %.3fms | emu %.0f fps (skip %u)",
+			filter_time, emulation.getFPS(), emulation.getFrameSkip());
+		if (audio && audio->isOpen()) {
+			RateStats rate = memory.getAPU().getRateControl().getStats();
+			snprintf(overlay + length, sizeof(overlay) - length, " | audio %.0f%% x%.4f (%.4f-%.4f) underruns %lu",
+				rate.average_fill * 100.0, rate.ratio, rate.min_ratio, rate.max_ratio, audio->getUnderruns());
+		}
+		graphics.setOverlayText(overlay);
+		graphics.presentFrame(pixels);
+		if (latency) tracker.framePresented(frames.getFront(), LatencyTracker::clock::now());
+	}
+
+	emulation.stop();
+#endif
+
+	report_shortcuts(cpu);
+
+	if (recorder && recorder->isOpen()) {
+		memory.getAPU().setRecorder(NULL);
+		recorder->close();
+		printf("Recorded %lu audio samples to %s\n", recorder->getSamplesWritten(), record_audio);
+	}
+
+#ifdef NES_COVERAGE
+	Coverage& coverage = memory.getCoverage();
+	coverage.report(cartridge);
+	std::string cdl_file = cdl ? cdl : std::string(rom).substr(0, std::string(rom).rfind('.')) + ".cdl";
+	if (coverage.writeCDL(cdl_file, cartridge)) printf("Wrote code/data log to %s\n", cdl_file.c_str());
+	if (heatmap) coverage.writeHeatmap(heatmap);
+#endif
+
+#ifdef NES_PROFILER
+	if (profile_report) cpu.get_profiler().writeReport(profile_report);
+	else cpu.get_profiler().writeReport(stdout);
+	if (profile_stacks) cpu.get_profiler().writeCollapsed(profile_stacks);
+#endif
+
+	if (latency) {
+		tracker.report();
+		if (latency_log) tracker.exportCSV(latency_log);
+	}
 
 	return 0;
-}
\ No newline at end of file
+}
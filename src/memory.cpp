@@ -1,10 +1,35 @@
 #include "memory.h"
 
-Memory::Memory(Cartridge& cartridge) : cartridge(cartridge) {
+#include <string.h>
 
+namespace {
+	const u16 OAM_ADDR_REGISTER = 0x2003;
+	const u16 OAM_DMA_REGISTER = 0x4014;
+	const u16 CONTROLLER_1_REGISTER = 0x4016;
+	const u16 CONTROLLER_2_REGISTER = 0x4017;
+	const u16 APU_STATUS_REGISTER = 0x4015;
+	const u16 APU_LAST_CHANNEL_REGISTER = 0x4013;
+
+	// Upper bits of controller reads are open bus, usually the $40 of the
+	// register address.
+	const u8 CONTROLLER_OPEN_BUS = 0x40;
+}
+
+Memory::Memory(Cartridge& cartridge) : cartridge(cartridge), apu(&cartridge) {
+	memset(oam, 0, sizeof(oam));
+	dma_pending = false;
+	logging = false;
+	write_log = NULL;
+	observed = false;
+#ifdef NES_COVERAGE
+	access = coverage::READ;
+#endif
+#ifdef NES_DEBUGGER
+	setDebugger(NULL, NULL);
+#endif
 }
 
-u8 Memory::readByte(u16 address) {
+u8 Memory::readBus(u16 address) {
 	/*
 	CPU memory map
 	$0000-$07FF:	2KB internal RAM
@@ -18,10 +43,14 @@ u8 Memory::readByte(u16 address) {
 	$4020-$FFFF:	Cartridge space: PRG ROM, PRG RAM, and mapper registers
 	*/
 
+#ifdef NES_COVERAGE
+	coverage.mark(address, access);
+#endif
+
 	// Internal RAM and RAM mirrors
 	if (0x0000 <= address && address <= 0x07FF) {
 		u8 byte = data[address];
-		printf("\033[31;1m[READ] Internal RAM: %02X,%04X\033[0m\n", byte, address);
+		if (logging) printf("\033[31;1m[READ] Internal RAM: %02X,%04X\033[0m\n", byte, address);
 		return byte;
 		// RAM allocation strategies located at https://wiki.nesdev.com/w/index.php/Sample_RAM_map
 		// Stack is located from $01A0 to $01FF
@@ -57,6 +86,11 @@ u8 Memory::readByte(u16 address) {
 	}
 
 
+	// Controllers
+	if (address == CONTROLLER_1_REGISTER) return controllers[0].read() | CONTROLLER_OPEN_BUS;
+	if (address == CONTROLLER_2_REGISTER) return controllers[1].read() | CONTROLLER_OPEN_BUS;
+	if (address == APU_STATUS_REGISTER) return apu.readStatus();
+
 	// APU and IO registers
 	if (0x4000 <= address && address <= 0x4017) {
 		u8 byte = data[address];
@@ -70,6 +104,9 @@ u8 Memory::readByte(u16 address) {
 		// (and more true to the hardware I guess) just give an address and the cartridge
 		// class should be able to handle the rest of the logic.
 		u8 byte = cartridge.read(address);
+#ifdef NES_COVERAGE
+		cartridge.markPRG(address, access);
+#endif
 		// printf("\033[31;1m[READ] PRG ROM: %02X,%04X\033[0m\n", byte, address);
 		return byte;
 	}
@@ -78,11 +115,15 @@ u8 Memory::readByte(u16 address) {
 	return 0x00;
 }
 
-void Memory::writeByte(u8 byte, u16 address) {
+void Memory::writeBus(u8 byte, u16 address) {
+#ifdef NES_COVERAGE
+	coverage.mark(address, coverage::WRITE);
+#endif
+	if (observed) observeWrite(byte, address);
+
 	// Internal RAM and RAM mirrors
 	if (0x0000 <= address && address <= 0x07FF) {
 		data[address] = byte;
-		printf("\033[31;1m[WRITE] Internal RAM: %02X,%04X\033[0m\n", byte, address);
 		return;
 	}
 	if (0x0800 <= address && address <= 0x0FFF) {
@@ -115,6 +156,29 @@ void Memory::writeByte(u8 byte, u16 address) {
 		return;
 	}
 
+	// OAM DMA, copies a whole page into sprite memory
+	if (address == OAM_DMA_REGISTER) {
+		oamDMA(byte);
+		return;
+	}
+
+	// Controller strobe, both ports share the line
+	if (address == CONTROLLER_1_REGISTER) {
+		controllers[0].strobe(byte & 0x1);
+		controllers[1].strobe(byte & 0x1);
+		data[address] = byte;
+		return;
+	}
+
+	// APU channels, status and frame counter ($4017 writes go to the APU,
+	// only reads belong to the second controller)
+	if ((0x4000 <= address && address <= APU_LAST_CHANNEL_REGISTER) ||
+		address == APU_STATUS_REGISTER || address == CONTROLLER_2_REGISTER) {
+		apu.writeRegister(address, byte);
+		data[address] = byte;
+		return;
+	}
+
 	// APU and IO registers
 	if (0x4000 <= address && address <= 0x4017) {
 		data[address] = byte;
@@ -125,4 +189,83 @@ void Memory::writeByte(u8 byte, u16 address) {
 	// TODO: Some cartridge mappers contain on board ram that can be written to
 
 	// printf("[WRITE] Unknown memory location: %04X\n", address);
+}
+
+u8* Memory::getRAMPage(u8 page) {
+	// $0000-$1FFF is 2KB of RAM mirrored four times
+	if (page < 0x20) return &data[(page & 0x07) << 8];
+	return NULL;
+}
+
+const u8* Memory::getOAM() {
+	return oam;
+}
+
+void Memory::setLogging(bool on) {
+	logging = on;
+	observed = logging || write_log;
+}
+
+void Memory::setWriteLog(std::vector<BusWrite>* log) {
+	write_log = log;
+	observed = logging || write_log;
+}
+
+void Memory::observeWrite(u8 byte, u16 address) {
+	if (write_log) write_log->push_back({address, byte});
+	if (logging && address <= 0x07FF) printf("\033[31;1m[WRITE] Internal RAM: %02X,%04X\033[0m\n", byte, address);
+}
+
+#ifdef NES_COVERAGE
+Coverage& Memory::getCoverage() {
+	return coverage;
+}
+#endif
+
+#ifdef NES_DEBUGGER
+void Memory::setDebugger(Debugger* debugger, const u8* pages) {
+	this->debugger = debugger;
+	for (unsigned int page = 0; page < 0x100; page++)
+		watch_pages[page] = debugger && pages ? pages[page] & (debug::READ | debug::WRITE) : 0;
+}
+#endif
+
+Controller& Memory::getController(int port) {
+	return controllers[port & 0x1];
+}
+
+bool Memory::takeDMAStall() {
+	bool pending = dma_pending;
+	dma_pending = false;
+	return pending;
+}
+
+void Memory::oamDMA(u8 page) {
+	// Grab the whole source page at once if it is backed by RAM or ROM,
+	// only fall back to single reads for pages mapped to registers.
+	u8 buffer[0x100];
+	const u8* source = getRAMPage(page);
+	if (source == NULL) source = cartridge.getPagePointer(page << 8);
+#ifdef NES_COVERAGE
+	// Page copies bypass readByte(), count them here
+	if (source != NULL) {
+		for (unsigned int i = 0; i < 0x100; i++) {
+			coverage.mark((page << 8) | i, coverage::READ);
+			cartridge.markPRG((page << 8) | i, coverage::READ);
+		}
+	}
+#endif
+	if (source == NULL) {
+		for (unsigned int i = 0; i < 0x100; i++)
+			buffer[i] = readByte((page << 8) | i);
+		source = buffer;
+	}
+
+	// DMA writes through $2004 so the copy starts at the current OAMADDR
+	// and wraps around the end of OAM.
+	u8 start = data[OAM_ADDR_REGISTER];
+	memcpy(&oam[start], source, 0x100 - start);
+	memcpy(oam, &source[0x100 - start], start);
+
+	dma_pending = true;
 }
\ No newline at end of file
@@ -3,22 +3,133 @@
 
 #include "definitions.h"
 #include "cartridge.h"
+#include "controller.h"
+#include "apu.h"
+#include "coverage.h"
+#include "debugger.h"
+
+#include <vector>
 
 /*
 Memory class to map all read and writes to memory to proper emulated
 locations.
 */
 
+// A CPU write as seen on the bus, see Memory::setWriteLog()
+struct BusWrite {
+	u16 address;
+	u8 value;
+};
+
 class Memory {
 public:
 	Memory(Cartridge& cartridge);
 
-	u8 readByte(u16 address);
-	void writeByte(u8 byte, u16 address);
+	// Debugger builds check the page's breakpoint bits around the bus
+	// access, a page without read or write breakpoints costs one test.
+#ifdef NES_DEBUGGER
+	u8 readByte(u16 address) {
+		u8 byte = readBus(address);
+		if (watch_pages[address >> 8] & debug::READ) debugger->checkAccess(address, byte, debug::READ);
+		return byte;
+	}
+	void writeByte(u8 byte, u16 address) {
+		writeBus(byte, address);
+		if (watch_pages[address >> 8] & debug::WRITE) debugger->checkAccess(address, byte, debug::WRITE);
+	}
+#else
+	u8 readByte(u16 address) { return readBus(address); }
+	void writeByte(u8 byte, u16 address) { writeBus(byte, address); }
+#endif
+
+	// Opcode and operand fetches, the same as readByte() except that
+	// coverage builds count them as executed instead of read and they
+	// never hit read breakpoints.
+#ifdef NES_COVERAGE
+	u8 fetchByte(u16 address) {
+		access = coverage::EXECUTE;
+		u8 byte = readBus(address);
+		access = coverage::READ;
+		return byte;
+	}
+#else
+	u8 fetchByte(u16 address) { return readBus(address); }
+#endif
+
+	// Reads internal RAM or PRG ROM without side effects or coverage marks,
+	// returns false for any other address.
+	bool peekByte(u16 address, u8& byte) {
+		if (address <= 0x1FFF) {
+			byte = data[address & 0x07FF];
+			return true;
+		}
+		const u8* page = cartridge.getPagePointer(address);
+		if (page == NULL) return false;
+		byte = page[address & 0xFF];
+		return true;
+	}
+
+	// Direct pointer to a 256 byte page of internal RAM (mirrors included),
+	// returns NULL for pages that are not backed by RAM.
+	u8* getRAMPage(u8 page);
+
+	// Sprite memory, filled by OAM DMA ($4014)
+	const u8* getOAM();
+
+	// Returns true (once) if an OAM DMA was started by the last write, the
+	// CPU is responsible for charging the 513/514 stall cycles.
+	bool takeDMAStall();
+
+	// Controllers on $4016 (port 0) and $4017 (port 1)
+	Controller& getController(int port);
+
+	// Audio, mapped at $4000-$4013, $4015 and $4017. The CPU asks it for
+	// stall cycles every tick, so it is kept inline.
+	APU& getAPU() { return apu; }
+
+#ifdef NES_COVERAGE
+	Coverage& getCoverage();
+#endif
+
+#ifdef NES_DEBUGGER
+	// Read and write breakpoints of debugger, pages holds its debug:: flags
+	// for each 256 byte page. NULL detaches it.
+	void setDebugger(Debugger* debugger, const u8* pages);
+#endif
+
+	// Log internal RAM accesses (used when tracing nestest)
+	void setLogging(bool on);
+
+	// Appends every CPU write to log (used by lockstep.h), NULL stops
+	void setWriteLog(std::vector<BusWrite>* log);
 
 private:
 	Cartridge& cartridge;
 	u8 data[0x10000];
+	u8 oam[0x100];
+	Controller controllers[2];
+	APU apu;
+
+	bool dma_pending;
+	bool logging;
+	std::vector<BusWrite>* write_log;
+	bool observed;	// Either of the above, the only test writes pay for them
+
+#ifdef NES_COVERAGE
+	Coverage coverage;
+	u8 access;	// What readBus() counts its access as
+#endif
+
+#ifdef NES_DEBUGGER
+	Debugger* debugger;
+	u8 watch_pages[0x100];	// debug::READ and WRITE bits only
+#endif
+
+	u8 readBus(u16 address);
+	void writeBus(u8 byte, u16 address);
+	void observeWrite(u8 byte, u16 address);
+
+	void oamDMA(u8 page);
 };
 
 #endif // MEMORY_H
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "movie.h"
+
+#include <stdio.h>
+#include <fstream>
+
+#include "controller.h"
+
+namespace {
+	// FM2 button columns, left to right
+	const u16 FM2_BUTTONS[8] = {
+		buttons::RIGHT, buttons::LEFT, buttons::DOWN, buttons::UP,
+		buttons::START, buttons::SELECT, buttons::B, buttons::A
+	};
+
+	u16 parse_buttons(const std::string& field) {
+		u16 held = 0;
+		for (size_t i = 0; i < field.size() && i < 8; i++) {
+			if (field[i] != '.' && field[i] != ' ') held |= FM2_BUTTONS[i];
+		}
+		return held;
+	}
+}
+
+bool Movie::load(const std::string filename) {
+	std::ifstream file(filename.c_str());
+	if (!file.is_open()) {
+		printf("ERROR: Unable to open %s!\n", filename.c_str());
+		return false;
+	}
+
+	input[0].clear();
+	input[1].clear();
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] != '|') continue;
+
+		// Split "|commands|port0|port1|port2|" into its fields
+		std::vector<std::string> fields;
+		size_t start = 1;
+		for (size_t end; (end = line.find('|', start)) != std::string::npos; start = end + 1)
+			fields.push_back(line.substr(start, end - start));
+		if (fields.size() < 2) {
+			printf("ERROR: Bad input line in %s: %s\n", filename.c_str(), line.c_str());
+			return false;
+		}
+
+		input[0].push_back(parse_buttons(fields[1]));
+		input[1].push_back(fields.size() > 2 ? parse_buttons(fields[2]) : 0);
+	}
+	return true;
+}
+
+u16 Movie::getButtons(unsigned long frame, int port) const {
+	const std::vector<u16>& frames = input[port & 1];
+	return frame < frames.size() ? frames[frame] : 0;
+}
+
+unsigned long Movie::getFrameCount() const {
+	return input[0].size();
+}
@@ -0,0 +1,30 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+
+/*
+Input movie in FCEUX's FM2 text format. Only the per-frame input lines
+are used, "|commands|RLDUTSBA|RLDUTSBA|port2|", where any character
+other than '.' or ' ' means the button is held. Header lines (key value)
+are skipped, so are the soft reset and power commands.
+*/
+
+class Movie {
+public:
+	// Returns false and prints an error if the file can't be read
+	bool load(const std::string filename);
+
+	// Buttons (see controller.h) held on port 0 or 1 during frame, where
+	// the first emulated frame is 0. Nothing is held past the end.
+	u16 getButtons(unsigned long frame, int port) const;
+
+	unsigned long getFrameCount() const;
+private:
+	std::vector<u16> input[2];
+};
+
+#endif // MOVIE_H
@@ -1,4 +1,146 @@
 #include "nes.h"
 
+#include <algorithm>
+
+namespace {
+	// 341 dots per scanline, 262 scanlines per NTSC frame
+	const unsigned int FRAME_PPU_DOTS = 341 * 262;
+}
+
 NES::NES(CPU& cpu, Memory& memory) : cpu(cpu), memory(memory) {
-}
\ No newline at end of file
+	frame_dots = 0;
+	frame_count = 0;
+	tracker = NULL;
+	tick_log = NULL;
+#ifdef NES_DEBUGGER
+	debugger = NULL;
+	resume_pc = -1;
+#endif
+}
+
+void NES::run_frame(bool render) {
+	if (tracker) tracker->beginFrame(frame_count + 1);
+
+	// 1 CPU cycle is equal to 3 PPU dots. Until there is a PPU the end of
+	// the frame is the only event idle loops can wait for, the last
+	// instruction of the frame starts at this cycle.
+	unsigned long long frame_end = cpu.get_total_cycles() + (FRAME_PPU_DOTS - frame_dots - 1) / 3;
+
+#ifdef NES_DEBUGGER
+	if (debugger && debugger->isActive()) {
+		while (run_until(~0ULL, frame_end + 1, render) != StopReason::FINISHED) debugger->printHit();
+		return;
+	}
+#endif
+
+	cpu.set_next_event(frame_end);
+	APU& apu = memory.getAPU();
+	while (frame_dots < FRAME_PPU_DOTS) {
+		unsigned int cycles = cpu.tick();
+		apu.run(cycles);
+		frame_dots += cycles * 3;
+	}
+	end_frame(render);
+}
+
+StopReason NES::step(unsigned long instructions) {
+	return run_until(cpu.get_instruction_count() + instructions, ~0ULL, false);
+}
+
+StopReason NES::run_cycles(unsigned long long cycles) {
+	return run_until(~0ULL, cpu.get_total_cycles() + cycles, false);
+}
+
+// Runs instructions until the instruction count reaches last_instruction,
+// the clock reaches last_cycle or a breakpoint stops it, finishing any
+// frames on the way.
+StopReason NES::run_until(unsigned long long last_instruction, unsigned long long last_cycle, bool render) {
+	APU& apu = memory.getAPU();
+	while (cpu.get_instruction_count() < last_instruction && cpu.get_total_cycles() < last_cycle) {
+		bool exact = last_instruction != ~0ULL;
+#ifdef NES_DEBUGGER
+		if (debugger && debugger->isActive()) {
+			u16 pc = cpu.regPC.value();
+			if (pc != resume_pc && debugger->checkExecute(pc)) {
+				resume_pc = pc;
+				return StopReason::BREAKPOINT;
+			}
+			resume_pc = -1;
+			debugger->beginInstruction(pc);
+			exact = true;
+		}
+#endif
+
+		// The shortcuts may run up to the end of the frame or of the run,
+		// but not past an instruction something has to stop after
+		unsigned long long frame_end = cpu.get_total_cycles() + (FRAME_PPU_DOTS - frame_dots - 1) / 3;
+		cpu.set_next_event(exact ? 0 : std::min(frame_end, last_cycle - 1));
+
+		// Peeked before the tick, it may overwrite code in RAM
+		u16 pc = cpu.regPC.value();
+		u8 opcode = 0;
+		if (tick_log) memory.peekByte(pc, opcode);
+
+		unsigned int cycles = cpu.tick();
+		if (tick_log) log_tick(pc, opcode);
+		apu.run(cycles);
+		frame_dots += cycles * 3;
+		if (frame_dots >= FRAME_PPU_DOTS) end_frame(render);
+
+#ifdef NES_DEBUGGER
+		if (debugger && debugger->takeStop()) return StopReason::WATCHPOINT;
+#endif
+	}
+	return StopReason::FINISHED;
+}
+
+void NES::end_frame(bool render) {
+	frame_dots -= FRAME_PPU_DOTS;
+	memory.getAPU().endFrame(render);
+
+	// The indices keep their initial value until there is a PPU to draw them
+	if (render) palette.convert(framebuffer.getIndices(), framebuffer.getPixels(), Framebuffer::WIDTH * Framebuffer::HEIGHT);
+	frame_count++;
+	framebuffer.setFrameNumber(frame_count);
+}
+
+void NES::log_tick(u16 pc, u8 opcode) {
+	TickLog::Entry& entry = tick_log->entries[tick_log->count++ % TickLog::ENTRIES];
+	entry.cycles = cpu.get_total_cycles();
+	entry.pc = pc;
+	entry.opcode = opcode;
+	entry.a = cpu.regA.value();
+	entry.x = cpu.regX.value();
+	entry.y = cpu.regY.value();
+	entry.p = cpu.regStatus.value();
+	entry.sp = cpu.regSP.value();
+}
+
+Framebuffer& NES::getFramebuffer() {
+	return framebuffer;
+}
+
+void NES::setLatencyTracker(LatencyTracker* tracker) {
+	this->tracker = tracker;
+	memory.getController(0).setLatencyTracker(tracker);
+	memory.getController(1).setLatencyTracker(tracker);
+}
+
+Palette& NES::getPalette() {
+	return palette;
+}
+
+unsigned long NES::getFrameCount() {
+	return frame_count;
+}
+
+void NES::setTickLog(TickLog* log) {
+	tick_log = log;
+}
+
+#ifdef NES_DEBUGGER
+void NES::setDebugger(Debugger* debugger) {
+	this->debugger = debugger;
+	resume_pc = -1;
+}
+#endif
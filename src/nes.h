@@ -3,13 +3,91 @@
 
 #include "cpu.h"
 #include "memory.h"
+#include "framebuffer.h"
+#include "palette.h"
+#include "latency_tracker.h"
+#include "debugger.h"
+
+// Why NES::step() or NES::run_cycles() returned
+enum class StopReason {
+	FINISHED,	// Ran everything that was asked for
+	BREAKPOINT,	// Execute breakpoint, the instruction at PC hasn't run yet
+	WATCHPOINT	// Read or write breakpoint, hit by the instruction before PC
+};
+
+/*
+The last ticks step() and run_cycles() ran, kept while a log is attached
+(Lockstep compares two of them). A tick is one instruction, or a whole
+skipped idle loop, fused pair or recompiled block.
+*/
+struct TickLog {
+	struct Entry {
+		unsigned long long cycles;	// Clock after the tick
+		u16 pc;	// Where it started
+		u8 opcode;
+		u8 a, x, y, p, sp;	// After it
+	};
+	static const size_t ENTRIES = 32;
+
+	Entry entries[ENTRIES];
+	unsigned long long count;	// Ticks logged, the newest is entries[(count - 1) % ENTRIES]
+};
 
 class NES {
 public:
 	NES(CPU& cpu, Memory& memory);
+
+	// Runs the CPU for one NTSC frame worth of cycles. Skipped frames
+	// (render = false) only cost core emulation time, the output pixels
+	// are left untouched and the audio output skips the frame.
+	void run_frame(bool render = true);
+
+	// Run a number of instructions, or until at least the given number of
+	// cycles have passed, stopping early at breakpoints in debugger builds.
+	// Frames that end on the way aren't rendered. Idle loop skipping,
+	// superinstructions and recompiled code only run while nothing needs
+	// to stop between two instructions, so step() always counts one
+	// instruction at a time.
+	StopReason step(unsigned long instructions = 1);
+	StopReason run_cycles(unsigned long long cycles);
+
+	Framebuffer& getFramebuffer();
+	Palette& getPalette();
+
+	// Optional input latency instrumentation for both controllers
+	void setLatencyTracker(LatencyTracker* tracker);
+	unsigned long getFrameCount();
+
+	// Logs every tick of step() and run_cycles() into log, NULL detaches
+	void setTickLog(TickLog* log);
+
+#ifdef NES_DEBUGGER
+	// Breakpoints, NULL detaches. run_frame() prints their hits and carries
+	// on, step() and run_cycles() stop at them.
+	void setDebugger(Debugger* debugger);
+#endif
 private:
 	CPU& cpu;
 	Memory& memory;
+
+	Framebuffer framebuffer;
+	Palette palette;
+	LatencyTracker* tracker;
+	TickLog* tick_log;
+
+	// PPU dots carried over from the previous frame, keeps the odd third of
+	// a CPU cycle per frame from drifting.
+	unsigned int frame_dots;
+	unsigned long frame_count;
+
+#ifdef NES_DEBUGGER
+	Debugger* debugger;
+	int resume_pc;	// Execute breakpoint stopped at, not hit again when resuming
+#endif
+
+	StopReason run_until(unsigned long long last_instruction, unsigned long long last_cycle, bool render);
+	void end_frame(bool render);
+	void log_tick(u16 pc, u8 opcode);
 };
 
-#endif // NES_H
\ No newline at end of file
+#endif // NES_H
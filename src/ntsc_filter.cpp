@@ -0,0 +1,143 @@
+#include "ntsc_filter.h"
+
+#include <chrono>
+#include <math.h>
+
+namespace {
+	const int PHASES = 12;	// Colour subcarrier period in samples
+	const int WINDOW = 12;	// Decoder averages one full subcarrier period
+
+	// 2728 samples per scanline, which moves the phase on by 4 every line
+	const int LINE_PHASE_STEP = 4;
+
+	// Composite voltages relative to sync, low and high levels for each
+	// of the four luma levels.
+	const float LEVELS_LOW[4] = { 0.350f, 0.518f, 0.962f, 1.550f };
+	const float LEVELS_HIGH[4] = { 1.094f, 1.506f, 1.962f, 1.962f };
+	const float BLACK = 0.518f;
+	const float WHITE = 1.962f;
+	const float ATTENUATION = 0.746f;
+
+	// Decoder hue tweak (in samples) lining the colour burst up with the
+	// PPU's phases, and the factor 2 that demodulation loses.
+	const float HUE_OFFSET = 3.9f;
+	const float CHROMA_GAIN = 2.0f;
+
+	bool in_color_phase(int color, int phase) {
+		return (color + phase) % 12 < 6;
+	}
+
+	// Normalised signal level for one sample of a palette entry
+	float signal(int entry, int phase) {
+		int color = entry & 0x0F;
+		int level = (entry >> 4) & 0x03;
+		if (color > 13) level = 1;	// Colours $xE/$xF are forced to black
+
+		float low = LEVELS_LOW[level];
+		float high = LEVELS_HIGH[level];
+		if (color == 0) low = high;
+		if (color > 12) high = low;
+
+		float value = in_color_phase(color, phase) ? high : low;
+
+		// Emphasis bits attenuate the signal during their part of the wave
+		if (((entry & 0x040) && in_color_phase(0, phase)) ||
+			((entry & 0x080) && in_color_phase(4, phase)) ||
+			((entry & 0x100) && in_color_phase(8, phase)))
+			value *= ATTENUATION;
+
+		return (value - BLACK) / (WHITE - BLACK);
+	}
+
+	u8 clamp(float value) {
+		if (value <= 0.0f) return 0;
+		if (value >= 1.0f) return 255;
+		return static_cast<u8>(value * 255.0f + 0.5f);
+	}
+}
+
+NTSCFilter::NTSCFilter(ThreadPool& pool) : pool(pool) {
+	alternate_phase = true;
+	frame = 0;
+	filter_time = 0.0;
+	buildKernel();
+}
+
+void NTSCFilter::setPhaseAlternation(bool on) {
+	alternate_phase = on;
+}
+
+double NTSCFilter::getFilterTime() {
+	return filter_time;
+}
+
+void NTSCFilter::buildKernel() {
+	// The signal only depends on the entry and where the sample falls in
+	// the subcarrier, so every sample the decoder will ever see is here.
+	kernel.resize(Palette::ENTRIES * PHASES);
+	for (int entry = 0; entry < Palette::ENTRIES; entry++) {
+		for (int phase = 0; phase < PHASES; phase++) {
+			float level = signal(entry, phase) / WINDOW;
+			Sample& sample = kernel[entry * PHASES + phase];
+			sample.y = level;
+			sample.i = CHROMA_GAIN * level * cosf(M_PI * (phase + HUE_OFFSET) / 6.0f);
+			sample.q = CHROMA_GAIN * level * sinf(M_PI * (phase + HUE_OFFSET) / 6.0f);
+		}
+	}
+}
+
+const u32* NTSCFilter::apply(const u16* indices, int width, int height) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	output.resize(width * OUTPUT_SCALE * height);
+
+	int frame_phase = (alternate_phase && (frame & 1)) ? LINE_PHASE_STEP : 0;
+	pool.runSlices(height, [&](int first_row, int end_row) {
+		for (int y = first_row; y < end_row; y++)
+			decodeLine(indices, width, y, (frame_phase + y * LINE_PHASE_STEP) % PHASES);
+	});
+	frame++;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	filter_time = elapsed.count();
+	return output.data();
+}
+
+void NTSCFilter::decodeLine(const u16* indices, int width, int y, int phase) {
+	// Running sums of Y/I/Q over the line's samples, padded by half a
+	// window on each side with the edge pixels, so each output pixel is
+	// just the difference of two sums.
+	const int pad = WINDOW / 2;
+	const int samples = width * SAMPLES_PER_PIXEL;
+	const u16* line = indices + y * width;
+
+	static thread_local std::vector<Sample> sums;
+	sums.resize(samples + 2 * pad + 1);
+	sums[0].y = sums[0].i = sums[0].q = 0.0f;
+	for (int s = -pad; s < samples + pad; s++) {
+		int x = s < 0 ? 0 : (s >= samples ? width - 1 : s / SAMPLES_PER_PIXEL);
+		int sample_phase = ((phase + s) % PHASES + PHASES) % PHASES;
+		const Sample& sample = kernel[(line[x] & (Palette::ENTRIES - 1)) * PHASES + sample_phase];
+		Sample& sum = sums[s + pad + 1];
+		const Sample& previous = sums[s + pad];
+		sum.y = previous.y + sample.y;
+		sum.i = previous.i + sample.i;
+		sum.q = previous.q + sample.q;
+	}
+
+	const int step = SAMPLES_PER_PIXEL / OUTPUT_SCALE;
+	u32* out = output.data() + y * width * OUTPUT_SCALE;
+	for (int x = 0; x < width * OUTPUT_SCALE; x++) {
+		// Window centred on the output pixel
+		int center = x * step + step / 2;
+		const Sample& end = sums[center + pad + pad];
+		const Sample& begin = sums[center + pad - pad];
+		float Y = end.y - begin.y;
+		float I = end.i - begin.i;
+		float Q = end.q - begin.q;
+
+		u8 r = clamp(Y + 0.946882f * I + 0.623557f * Q);
+		u8 g = clamp(Y - 0.274788f * I - 0.635691f * Q);
+		u8 b = clamp(Y - 1.108545f * I + 1.709007f * Q);
+		out[x] = 0xFF000000 | (r << 16) | (g << 8) | b;
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef NTSC_FILTER_H
+#define NTSC_FILTER_H
+
+#include <vector>
+
+#include "definitions.h"
+#include "palette.h"
+#include "thread_pool.h"
+
+/*
+Composite video filter working straight from the PPU palette indices.
+Every pixel becomes 8 samples of the NES square wave signal which are
+then decoded back into YIQ, giving dot crawl and colour bleed. Signal
+levels for every index/emphasis/phase combination are computed once
+and cached, scanlines are decoded in parallel.
+*/
+
+class NTSCFilter {
+public:
+	// Output is twice the width of the input (4 samples per output pixel)
+	static const int SAMPLES_PER_PIXEL = 8;
+	static const int OUTPUT_SCALE = 2;
+
+	NTSCFilter(ThreadPool& pool);
+
+	// Alternate the colour subcarrier phase every other frame, like the
+	// real PPU does with rendering on. Off gives a stable picture.
+	void setPhaseAlternation(bool on);
+
+	// Decodes a width*height index frame into (width*2)*height ARGB8888
+	const u32* apply(const u16* indices, int width, int height);
+
+	// Milliseconds spent in the last apply()
+	double getFilterTime();
+private:
+	ThreadPool& pool;
+	bool alternate_phase;
+	unsigned long frame;
+	double filter_time;
+
+	// Y, I and Q contributions of one signal sample, indexed by
+	// [palette entry][subcarrier phase 0-11]
+	struct Sample {
+		float y, i, q;
+	};
+	std::vector<Sample> kernel;
+
+	std::vector<u32> output;
+
+	void buildKernel();
+	void decodeLine(const u16* indices, int width, int y, int phase);
+};
+
+#endif // NTSC_FILTER_H
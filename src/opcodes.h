@@ -0,0 +1,304 @@
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include "definitions.h"
+
+/*
+What there is to know about each of the 256 opcodes, shared by the
+tracer, the profiler, idle loop detection, fusion and the recompiler.
+It's constant data the compiler lays out, nothing is constructed at
+startup, and it can be used in constant expressions.
+
+Cycles are the base count. Opcodes with page_penalty take one more when
+indexing crosses a page, branches one more when taken and another when
+the target is on a different page. Unofficial opcodes are listed with
+their usual names and timings, official is false for them.
+*/
+
+namespace opcodes {
+	enum AddressMode : u8 {
+		IMP,	// Implied
+		ACC,	// Accumulator
+		IMM,	// #$nn
+		ZPG,	// $nn
+		ZPX,	// $nn,X
+		ZPY,	// $nn,Y
+		ABS,	// $nnnn
+		ABX,	// $nnnn,X
+		ABY,	// $nnnn,Y
+		IND,	// ($nnnn), JMP only
+		IZX,	// ($nn,X)
+		IZY,	// ($nn),Y
+		REL		// Branch offset
+	};
+
+	struct Info {
+		const char* mnemonic;
+		AddressMode mode;
+		u8 length;	// Bytes, opcode included
+		u8 cycles;
+		bool page_penalty;
+		bool official;
+	};
+
+	constexpr Info TABLE[256] = {
+		{"BRK", IMP, 1, 7, false, true},	// 00
+		{"ORA", IZX, 2, 6, false, true},	// 01
+		{"STP", IMP, 1, 2, false, false},	// 02
+		{"SLO", IZX, 2, 8, false, false},	// 03
+		{"NOP", ZPG, 2, 3, false, false},	// 04
+		{"ORA", ZPG, 2, 3, false, true},	// 05
+		{"ASL", ZPG, 2, 5, false, true},	// 06
+		{"SLO", ZPG, 2, 5, false, false},	// 07
+		{"PHP", IMP, 1, 3, false, true},	// 08
+		{"ORA", IMM, 2, 2, false, true},	// 09
+		{"ASL", ACC, 1, 2, false, true},	// 0A
+		{"ANC", IMM, 2, 2, false, false},	// 0B
+		{"NOP", ABS, 3, 4, false, false},	// 0C
+		{"ORA", ABS, 3, 4, false, true},	// 0D
+		{"ASL", ABS, 3, 6, false, true},	// 0E
+		{"SLO", ABS, 3, 6, false, false},	// 0F
+		{"BPL", REL, 2, 2, true, true},	// 10
+		{"ORA", IZY, 2, 5, true, true},	// 11
+		{"STP", IMP, 1, 2, false, false},	// 12
+		{"SLO", IZY, 2, 8, false, false},	// 13
+		{"NOP", ZPX, 2, 4, false, false},	// 14
+		{"ORA", ZPX, 2, 4, false, true},	// 15
+		{"ASL", ZPX, 2, 6, false, true},	// 16
+		{"SLO", ZPX, 2, 6, false, false},	// 17
+		{"CLC", IMP, 1, 2, false, true},	// 18
+		{"ORA", ABY, 3, 4, true, true},	// 19
+		{"NOP", IMP, 1, 2, false, false},	// 1A
+		{"SLO", ABY, 3, 7, false, false},	// 1B
+		{"NOP", ABX, 3, 4, true, false},	// 1C
+		{"ORA", ABX, 3, 4, true, true},	// 1D
+		{"ASL", ABX, 3, 7, false, true},	// 1E
+		{"SLO", ABX, 3, 7, false, false},	// 1F
+		{"JSR", ABS, 3, 6, false, true},	// 20
+		{"AND", IZX, 2, 6, false, true},	// 21
+		{"STP", IMP, 1, 2, false, false},	// 22
+		{"RLA", IZX, 2, 8, false, false},	// 23
+		{"BIT", ZPG, 2, 3, false, true},	// 24
+		{"AND", ZPG, 2, 3, false, true},	// 25
+		{"ROL", ZPG, 2, 5, false, true},	// 26
+		{"RLA", ZPG, 2, 5, false, false},	// 27
+		{"PLP", IMP, 1, 4, false, true},	// 28
+		{"AND", IMM, 2, 2, false, true},	// 29
+		{"ROL", ACC, 1, 2, false, true},	// 2A
+		{"ANC", IMM, 2, 2, false, false},	// 2B
+		{"BIT", ABS, 3, 4, false, true},	// 2C
+		{"AND", ABS, 3, 4, false, true},	// 2D
+		{"ROL", ABS, 3, 6, false, true},	// 2E
+		{"RLA", ABS, 3, 6, false, false},	// 2F
+		{"BMI", REL, 2, 2, true, true},	// 30
+		{"AND", IZY, 2, 5, true, true},	// 31
+		{"STP", IMP, 1, 2, false, false},	// 32
+		{"RLA", IZY, 2, 8, false, false},	// 33
+		{"NOP", ZPX, 2, 4, false, false},	// 34
+		{"AND", ZPX, 2, 4, false, true},	// 35
+		{"ROL", ZPX, 2, 6, false, true},	// 36
+		{"RLA", ZPX, 2, 6, false, false},	// 37
+		{"SEC", IMP, 1, 2, false, true},	// 38
+		{"AND", ABY, 3, 4, true, true},	// 39
+		{"NOP", IMP, 1, 2, false, false},	// 3A
+		{"RLA", ABY, 3, 7, false, false},	// 3B
+		{"NOP", ABX, 3, 4, true, false},	// 3C
+		{"AND", ABX, 3, 4, true, true},	// 3D
+		{"ROL", ABX, 3, 7, false, true},	// 3E
+		{"RLA", ABX, 3, 7, false, false},	// 3F
+		{"RTI", IMP, 1, 6, false, true},	// 40
+		{"EOR", IZX, 2, 6, false, true},	// 41
+		{"STP", IMP, 1, 2, false, false},	// 42
+		{"SRE", IZX, 2, 8, false, false},	// 43
+		{"NOP", ZPG, 2, 3, false, false},	// 44
+		{"EOR", ZPG, 2, 3, false, true},	// 45
+		{"LSR", ZPG, 2, 5, false, true},	// 46
+		{"SRE", ZPG, 2, 5, false, false},	// 47
+		{"PHA", IMP, 1, 3, false, true},	// 48
+		{"EOR", IMM, 2, 2, false, true},	// 49
+		{"LSR", ACC, 1, 2, false, true},	// 4A
+		{"ALR", IMM, 2, 2, false, false},	// 4B
+		{"JMP", ABS, 3, 3, false, true},	// 4C
+		{"EOR", ABS, 3, 4, false, true},	// 4D
+		{"LSR", ABS, 3, 6, false, true},	// 4E
+		{"SRE", ABS, 3, 6, false, false},	// 4F
+		{"BVC", REL, 2, 2, true, true},	// 50
+		{"EOR", IZY, 2, 5, true, true},	// 51
+		{"STP", IMP, 1, 2, false, false},	// 52
+		{"SRE", IZY, 2, 8, false, false},	// 53
+		{"NOP", ZPX, 2, 4, false, false},	// 54
+		{"EOR", ZPX, 2, 4, false, true},	// 55
+		{"LSR", ZPX, 2, 6, false, true},	// 56
+		{"SRE", ZPX, 2, 6, false, false},	// 57
+		{"CLI", IMP, 1, 2, false, true},	// 58
+		{"EOR", ABY, 3, 4, true, true},	// 59
+		{"NOP", IMP, 1, 2, false, false},	// 5A
+		{"SRE", ABY, 3, 7, false, false},	// 5B
+		{"NOP", ABX, 3, 4, true, false},	// 5C
+		{"EOR", ABX, 3, 4, true, true},	// 5D
+		{"LSR", ABX, 3, 7, false, true},	// 5E
+		{"SRE", ABX, 3, 7, false, false},	// 5F
+		{"RTS", IMP, 1, 6, false, true},	// 60
+		{"ADC", IZX, 2, 6, false, true},	// 61
+		{"STP", IMP, 1, 2, false, false},	// 62
+		{"RRA", IZX, 2, 8, false, false},	// 63
+		{"NOP", ZPG, 2, 3, false, false},	// 64
+		{"ADC", ZPG, 2, 3, false, true},	// 65
+		{"ROR", ZPG, 2, 5, false, true},	// 66
+		{"RRA", ZPG, 2, 5, false, false},	// 67
+		{"PLA", IMP, 1, 4, false, true},	// 68
+		{"ADC", IMM, 2, 2, false, true},	// 69
+		{"ROR", ACC, 1, 2, false, true},	// 6A
+		{"ARR", IMM, 2, 2, false, false},	// 6B
+		{"JMP", IND, 3, 5, false, true},	// 6C
+		{"ADC", ABS, 3, 4, false, true},	// 6D
+		{"ROR", ABS, 3, 6, false, true},	// 6E
+		{"RRA", ABS, 3, 6, false, false},	// 6F
+		{"BVS", REL, 2, 2, true, true},	// 70
+		{"ADC", IZY, 2, 5, true, true},	// 71
+		{"STP", IMP, 1, 2, false, false},	// 72
+		{"RRA", IZY, 2, 8, false, false},	// 73
+		{"NOP", ZPX, 2, 4, false, false},	// 74
+		{"ADC", ZPX, 2, 4, false, true},	// 75
+		{"ROR", ZPX, 2, 6, false, true},	// 76
+		{"RRA", ZPX, 2, 6, false, false},	// 77
+		{"SEI", IMP, 1, 2, false, true},	// 78
+		{"ADC", ABY, 3, 4, true, true},	// 79
+		{"NOP", IMP, 1, 2, false, false},	// 7A
+		{"RRA", ABY, 3, 7, false, false},	// 7B
+		{"NOP", ABX, 3, 4, true, false},	// 7C
+		{"ADC", ABX, 3, 4, true, true},	// 7D
+		{"ROR", ABX, 3, 7, false, true},	// 7E
+		{"RRA", ABX, 3, 7, false, false},	// 7F
+		{"NOP", IMM, 2, 2, false, false},	// 80
+		{"STA", IZX, 2, 6, false, true},	// 81
+		{"NOP", IMM, 2, 2, false, false},	// 82
+		{"SAX", IZX, 2, 6, false, false},	// 83
+		{"STY", ZPG, 2, 3, false, true},	// 84
+		{"STA", ZPG, 2, 3, false, true},	// 85
+		{"STX", ZPG, 2, 3, false, true},	// 86
+		{"SAX", ZPG, 2, 3, false, false},	// 87
+		{"DEY", IMP, 1, 2, false, true},	// 88
+		{"NOP", IMM, 2, 2, false, false},	// 89
+		{"TXA", IMP, 1, 2, false, true},	// 8A
+		{"XAA", IMM, 2, 2, false, false},	// 8B
+		{"STY", ABS, 3, 4, false, true},	// 8C
+		{"STA", ABS, 3, 4, false, true},	// 8D
+		{"STX", ABS, 3, 4, false, true},	// 8E
+		{"SAX", ABS, 3, 4, false, false},	// 8F
+		{"BCC", REL, 2, 2, true, true},	// 90
+		{"STA", IZY, 2, 6, false, true},	// 91
+		{"STP", IMP, 1, 2, false, false},	// 92
+		{"AHX", IZY, 2, 6, false, false},	// 93
+		{"STY", ZPX, 2, 4, false, true},	// 94
+		{"STA", ZPX, 2, 4, false, true},	// 95
+		{"STX", ZPY, 2, 4, false, true},	// 96
+		{"SAX", ZPY, 2, 4, false, false},	// 97
+		{"TYA", IMP, 1, 2, false, true},	// 98
+		{"STA", ABY, 3, 5, false, true},	// 99
+		{"TXS", IMP, 1, 2, false, true},	// 9A
+		{"TAS", ABY, 3, 5, false, false},	// 9B
+		{"SHY", ABX, 3, 5, false, false},	// 9C
+		{"STA", ABX, 3, 5, false, true},	// 9D
+		{"SHX", ABY, 3, 5, false, false},	// 9E
+		{"AHX", ABY, 3, 5, false, false},	// 9F
+		{"LDY", IMM, 2, 2, false, true},	// A0
+		{"LDA", IZX, 2, 6, false, true},	// A1
+		{"LDX", IMM, 2, 2, false, true},	// A2
+		{"LAX", IZX, 2, 6, false, false},	// A3
+		{"LDY", ZPG, 2, 3, false, true},	// A4
+		{"LDA", ZPG, 2, 3, false, true},	// A5
+		{"LDX", ZPG, 2, 3, false, true},	// A6
+		{"LAX", ZPG, 2, 3, false, false},	// A7
+		{"TAY", IMP, 1, 2, false, true},	// A8
+		{"LDA", IMM, 2, 2, false, true},	// A9
+		{"TAX", IMP, 1, 2, false, true},	// AA
+		{"LAX", IMM, 2, 2, false, false},	// AB
+		{"LDY", ABS, 3, 4, false, true},	// AC
+		{"LDA", ABS, 3, 4, false, true},	// AD
+		{"LDX", ABS, 3, 4, false, true},	// AE
+		{"LAX", ABS, 3, 4, false, false},	// AF
+		{"BCS", REL, 2, 2, true, true},	// B0
+		{"LDA", IZY, 2, 5, true, true},	// B1
+		{"STP", IMP, 1, 2, false, false},	// B2
+		{"LAX", IZY, 2, 5, true, false},	// B3
+		{"LDY", ZPX, 2, 4, false, true},	// B4
+		{"LDA", ZPX, 2, 4, false, true},	// B5
+		{"LDX", ZPY, 2, 4, false, true},	// B6
+		{"LAX", ZPY, 2, 4, false, false},	// B7
+		{"CLV", IMP, 1, 2, false, true},	// B8
+		{"LDA", ABY, 3, 4, true, true},	// B9
+		{"TSX", IMP, 1, 2, false, true},	// BA
+		{"LAS", ABY, 3, 4, true, false},	// BB
+		{"LDY", ABX, 3, 4, true, true},	// BC
+		{"LDA", ABX, 3, 4, true, true},	// BD
+		{"LDX", ABY, 3, 4, true, true},	// BE
+		{"LAX", ABY, 3, 4, true, false},	// BF
+		{"CPY", IMM, 2, 2, false, true},	// C0
+		{"CMP", IZX, 2, 6, false, true},	// C1
+		{"NOP", IMM, 2, 2, false, false},	// C2
+		{"DCP", IZX, 2, 8, false, false},	// C3
+		{"CPY", ZPG, 2, 3, false, true},	// C4
+		{"CMP", ZPG, 2, 3, false, true},	// C5
+		{"DEC", ZPG, 2, 5, false, true},	// C6
+		{"DCP", ZPG, 2, 5, false, false},	// C7
+		{"INY", IMP, 1, 2, false, true},	// C8
+		{"CMP", IMM, 2, 2, false, true},	// C9
+		{"DEX", IMP, 1, 2, false, true},	// CA
+		{"AXS", IMM, 2, 2, false, false},	// CB
+		{"CPY", ABS, 3, 4, false, true},	// CC
+		{"CMP", ABS, 3, 4, false, true},	// CD
+		{"DEC", ABS, 3, 6, false, true},	// CE
+		{"DCP", ABS, 3, 6, false, false},	// CF
+		{"BNE", REL, 2, 2, true, true},	// D0
+		{"CMP", IZY, 2, 5, true, true},	// D1
+		{"STP", IMP, 1, 2, false, false},	// D2
+		{"DCP", IZY, 2, 8, false, false},	// D3
+		{"NOP", ZPX, 2, 4, false, false},	// D4
+		{"CMP", ZPX, 2, 4, false, true},	// D5
+		{"DEC", ZPX, 2, 6, false, true},	// D6
+		{"DCP", ZPX, 2, 6, false, false},	// D7
+		{"CLD", IMP, 1, 2, false, true},	// D8
+		{"CMP", ABY, 3, 4, true, true},	// D9
+		{"NOP", IMP, 1, 2, false, false},	// DA
+		{"DCP", ABY, 3, 7, false, false},	// DB
+		{"NOP", ABX, 3, 4, true, false},	// DC
+		{"CMP", ABX, 3, 4, true, true},	// DD
+		{"DEC", ABX, 3, 7, false, true},	// DE
+		{"DCP", ABX, 3, 7, false, false},	// DF
+		{"CPX", IMM, 2, 2, false, true},	// E0
+		{"SBC", IZX, 2, 6, false, true},	// E1
+		{"NOP", IMM, 2, 2, false, false},	// E2
+		{"ISC", IZX, 2, 8, false, false},	// E3
+		{"CPX", ZPG, 2, 3, false, true},	// E4
+		{"SBC", ZPG, 2, 3, false, true},	// E5
+		{"INC", ZPG, 2, 5, false, true},	// E6
+		{"ISC", ZPG, 2, 5, false, false},	// E7
+		{"INX", IMP, 1, 2, false, true},	// E8
+		{"SBC", IMM, 2, 2, false, true},	// E9
+		{"NOP", IMP, 1, 2, false, true},	// EA
+		{"SBC", IMM, 2, 2, false, false},	// EB
+		{"CPX", ABS, 3, 4, false, true},	// EC
+		{"SBC", ABS, 3, 4, false, true},	// ED
+		{"INC", ABS, 3, 6, false, true},	// EE
+		{"ISC", ABS, 3, 6, false, false},	// EF
+		{"BEQ", REL, 2, 2, true, true},	// F0
+		{"SBC", IZY, 2, 5, true, true},	// F1
+		{"STP", IMP, 1, 2, false, false},	// F2
+		{"ISC", IZY, 2, 8, false, false},	// F3
+		{"NOP", ZPX, 2, 4, false, false},	// F4
+		{"SBC", ZPX, 2, 4, false, true},	// F5
+		{"INC", ZPX, 2, 6, false, true},	// F6
+		{"ISC", ZPX, 2, 6, false, false},	// F7
+		{"SED", IMP, 1, 2, false, true},	// F8
+		{"SBC", ABY, 3, 4, true, true},	// F9
+		{"NOP", IMP, 1, 2, false, false},	// FA
+		{"ISC", ABY, 3, 7, false, false},	// FB
+		{"NOP", ABX, 3, 4, true, false},	// FC
+		{"SBC", ABX, 3, 4, true, true},	// FD
+		{"INC", ABX, 3, 7, false, true},	// FE
+		{"ISC", ABX, 3, 7, false, false},	// FF
+	};
+}
+
+#endif // OPCODES_H
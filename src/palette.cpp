@@ -0,0 +1,140 @@
+#include "palette.h"
+
+#include <stdio.h>
+#include <fstream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PALETTE_X86
+#endif
+
+namespace {
+	// Standard 2C02 colours
+	const u32 DEFAULT_PALETTE[Palette::COLORS] = {
+		0x7C7C7C, 0x0000FC, 0x0000BC, 0x4428BC, 0x940084, 0xA80020, 0xA81000, 0x881400,
+		0x503000, 0x007800, 0x006800, 0x005800, 0x004058, 0x000000, 0x000000, 0x000000,
+		0xBCBCBC, 0x0078F8, 0x0058F8, 0x6844FC, 0xD800CC, 0xE40058, 0xF83800, 0xE45C10,
+		0xAC7C00, 0x00B800, 0x00A800, 0x00A844, 0x008888, 0x000000, 0x000000, 0x000000,
+		0xF8F8F8, 0x3CBCFC, 0x6888FC, 0x9878F8, 0xF878F8, 0xF85898, 0xF87858, 0xFCA044,
+		0xF8B800, 0xB8F818, 0x58D854, 0x58F898, 0x00E8D8, 0x787878, 0x000000, 0x000000,
+		0xFCFCFC, 0xA4E4FC, 0xB8B8F8, 0xD8B8F8, 0xF8B8F8, 0xF8A4C0, 0xF0D0B0, 0xFCE0A8,
+		0xF8D878, 0xD8F878, 0xB8F8B8, 0xB8F8D8, 0x00FCFC, 0xF8D8F8, 0x000000, 0x000000
+	};
+
+	// Emphasised channels keep their level, the others are dimmed
+	const float EMPHASIS_ATTENUATION = 0.816328f;
+}
+
+Palette::Palette() {
+	format = PixelFormat::ARGB8888;
+	version = 0;
+#ifdef PALETTE_X86
+	has_avx2 = __builtin_cpu_supports("avx2");
+#else
+	has_avx2 = false;
+#endif
+
+	for (int i = 0; i < COLORS; i++) rgb[i] = DEFAULT_PALETTE[i];
+	applyEmphasis();
+	buildLUT();
+}
+
+bool Palette::load(const std::string filename) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file.is_open()) {
+		printf("ERROR: Unable to open palette %s!\n", filename.c_str());
+		return false;
+	}
+
+	std::vector<u8> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (bytes.size() != COLORS * 3 && bytes.size() != ENTRIES * 3) {
+		printf("ERROR: Palette %s should be %i or %i bytes, not %lu\n", filename.c_str(), COLORS * 3, ENTRIES * 3, bytes.size());
+		return false;
+	}
+
+	for (size_t i = 0; i < bytes.size() / 3; i++)
+		rgb[i] = (bytes[i * 3] << 16) | (bytes[i * 3 + 1] << 8) | bytes[i * 3 + 2];
+
+	// Small palettes don't carry emphasis colours, derive them
+	if (bytes.size() == COLORS * 3) applyEmphasis();
+	buildLUT();
+	return true;
+}
+
+void Palette::setFormat(PixelFormat format) {
+	this->format = format;
+	buildLUT();
+}
+
+PixelFormat Palette::getFormat() {
+	return format;
+}
+
+unsigned int Palette::getVersion() {
+	return version;
+}
+
+u32 Palette::getRGB(u16 index) {
+	return rgb[index & (ENTRIES - 1)];
+}
+
+void Palette::applyEmphasis() {
+	// Emphasis bits 6, 7 and 8 select red, green and blue
+	for (int emphasis = 1; emphasis < 8; emphasis++) {
+		for (int color = 0; color < COLORS; color++) {
+			u32 base = rgb[color];
+			u32 result = 0;
+			for (int channel = 0; channel < 3; channel++) {
+				int shift = 16 - channel * 8;
+				float level = (base >> shift) & 0xFF;
+				// Colours $xE/$xF are forced black and don't react to emphasis
+				bool emphasised = emphasis & (1 << channel);
+				if (!emphasised && (color & 0x0E) != 0x0E) level *= EMPHASIS_ATTENUATION;
+				result |= static_cast<u32>(level + 0.5f) << shift;
+			}
+			rgb[emphasis * COLORS + color] = result;
+		}
+	}
+}
+
+void Palette::buildLUT() {
+	for (int i = 0; i < ENTRIES; i++) {
+		u32 r = (rgb[i] >> 16) & 0xFF;
+		u32 g = (rgb[i] >> 8) & 0xFF;
+		u32 b = rgb[i] & 0xFF;
+		if (format == PixelFormat::ARGB8888) lut[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+		else lut[i] = 0xFF000000 | (b << 16) | (g << 8) | r;
+	}
+	version++;
+}
+
+void Palette::convert(const u16* indices, u32* pixels, size_t count) {
+	if (has_avx2) convertAVX2(indices, pixels, count);
+	else convertScalar(indices, pixels, count);
+}
+
+void Palette::convertScalar(const u16* indices, u32* pixels, size_t count) {
+	for (size_t i = 0; i < count; i++) pixels[i] = lut[indices[i] & (ENTRIES - 1)];
+}
+
+#ifdef PALETTE_X86
+__attribute__((target("avx2")))
+void Palette::convertAVX2(const u16* indices, u32* pixels, size_t count) {
+	// Widen 8 indices at a time to 32 bits and gather them from the table
+	const __m256i mask = _mm256_set1_epi32(ENTRIES - 1);
+	const int* table = reinterpret_cast<const int*>(lut);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+		__m256i index = _mm256_and_si256(_mm256_cvtepu16_epi32(packed), mask);
+		__m256i result = _mm256_i32gather_epi32(table, index, 4);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), result);
+	}
+	convertScalar(indices + i, pixels + i, count - i);
+}
+#else
+void Palette::convertAVX2(const u16* indices, u32* pixels, size_t count) {
+	convertScalar(indices, pixels, count);
+}
+#endif
@@ -0,0 +1,56 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stddef.h>
+#include <string>
+
+#include "definitions.h"
+
+// Byte order of converted pixels, named the way SDL names them (packed
+// 32-bit values, so ARGB8888 is B,G,R,A in memory on little endian).
+enum class PixelFormat {
+	ARGB8888, ABGR8888
+};
+
+/*
+Turns PPU palette indices into host pixels. Every index/emphasis
+combination (64 colours * 8 emphasis settings) is looked up in a 512
+entry table that is rebuilt whenever the palette or format changes.
+*/
+
+class Palette {
+public:
+	static const int COLORS = 64;
+	static const int ENTRIES = COLORS * 8;
+
+	Palette();
+
+	// Loads a .pal file, either 64 RGB triplets or 512 (with emphasis)
+	bool load(const std::string filename);
+
+	void setFormat(PixelFormat format);
+	PixelFormat getFormat();
+
+	// Converts count indices into pixels, uses AVX2 when the host has it
+	void convert(const u16* indices, u32* pixels, size_t count);
+	void convertScalar(const u16* indices, u32* pixels, size_t count);
+	void convertAVX2(const u16* indices, u32* pixels, size_t count);
+
+	// Incremented every time the lookup table is rebuilt, lets filters
+	// know their cached tables are stale.
+	unsigned int getVersion();
+
+	// RGB (0xRRGGBB) for an index with emphasis bits
+	u32 getRGB(u16 index);
+private:
+	u32 rgb[ENTRIES];
+	u32 lut[ENTRIES];
+	PixelFormat format;
+	bool has_avx2;
+	unsigned int version;
+
+	void applyEmphasis();
+	void buildLUT();
+};
+
+#endif // PALETTE_H
@@ -0,0 +1,147 @@
+#include "profiler.h"
+
+#ifdef NES_PROFILER
+
+#include <algorithm>
+#include <string.h>
+
+#include "opcodes.h"
+
+namespace {
+	const unsigned int REPORT_ENTRIES = 20;
+
+	double percent(u64 part, u64 total) {
+		return total ? 100.0 * part / total : 0.0;
+	}
+}
+
+Profiler::Profiler() {
+	reset();
+}
+
+void Profiler::reset() {
+	memset(pc_cycles, 0, sizeof(pc_cycles));
+	memset(opcode_cycles, 0, sizeof(opcode_cycles));
+	memset(opcode_counts, 0, sizeof(opcode_counts));
+
+	// Node 0 is whatever runs outside any subroutine (from reset)
+	nodes.clear();
+	children.clear();
+	Node root = { 0, 0, 0, 0 };
+	nodes.push_back(root);
+	current = 0;
+	overflow = 0;
+}
+
+void Profiler::call(u16 target) {
+	if (nodes[current].depth >= MAX_DEPTH) {
+		overflow++;
+		return;
+	}
+
+	u64 key = (static_cast<u64>(current) << 16) | target;
+	std::unordered_map<u64, u32>::iterator child = children.find(key);
+	if (child != children.end()) {
+		current = child->second;
+		return;
+	}
+
+	Node node = { target, current, nodes[current].depth + 1, 0 };
+	nodes.push_back(node);
+	current = nodes.size() - 1;
+	children[key] = current;
+}
+
+void Profiler::ret() {
+	if (overflow > 0) {
+		overflow--;
+		return;
+	}
+	current = nodes[current].parent;
+}
+
+void Profiler::writeReport(FILE* file) {
+	u64 total = 0;
+	for (int i = 0; i < 256; i++) total += opcode_cycles[i];
+
+	fprintf(file, "\n+--------+\n");
+	fprintf(file, "|PROFILER|\n");
+	fprintf(file, "+--------+\n\n");
+	fprintf(file, "TOTAL CYCLES: %llu\n", static_cast<unsigned long long>(total));
+
+	// Sort indices rather than the tables themselves
+	std::vector<u32> order;
+	for (u32 pc = 0; pc < 0x10000; pc++) if (pc_cycles[pc]) order.push_back(pc);
+	std::sort(order.begin(), order.end(), [this](u32 a, u32 b) { return pc_cycles[a] > pc_cycles[b]; });
+	fprintf(file, "\nHOTTEST PCS:\n");
+	for (size_t i = 0; i < order.size() && i < REPORT_ENTRIES; i++)
+		fprintf(file, "  $%04X %12llu cycles %6.2f%%\n", order[i],
+			static_cast<unsigned long long>(pc_cycles[order[i]]), percent(pc_cycles[order[i]], total));
+
+	order.clear();
+	for (u32 opcode = 0; opcode < 256; opcode++) if (opcode_counts[opcode]) order.push_back(opcode);
+	std::sort(order.begin(), order.end(), [this](u32 a, u32 b) { return opcode_cycles[a] > opcode_cycles[b]; });
+	fprintf(file, "\nOPCODES:\n");
+	for (size_t i = 0; i < order.size(); i++)
+		fprintf(file, "  %02X %s %12llu executed %12llu cycles %6.2f%%\n", order[i], opcodes::TABLE[order[i]].mnemonic,
+			static_cast<unsigned long long>(opcode_counts[order[i]]),
+			static_cast<unsigned long long>(opcode_cycles[order[i]]), percent(opcode_cycles[order[i]], total));
+
+	// Self cycles summed over every call path of a subroutine
+	std::unordered_map<u32, u64> self;
+	for (size_t i = 0; i < nodes.size(); i++) self[i == 0 ? 0x10000 : nodes[i].address] += nodes[i].cycles;
+	std::vector<std::pair<u64, u32> > subroutines;
+	for (std::unordered_map<u32, u64>::iterator i = self.begin(); i != self.end(); i++)
+		subroutines.push_back(std::make_pair(i->second, i->first));
+	std::sort(subroutines.rbegin(), subroutines.rend());
+	fprintf(file, "\nSUBROUTINES (SELF):\n");
+	for (size_t i = 0; i < subroutines.size() && i < REPORT_ENTRIES; i++) {
+		if (subroutines[i].second == 0x10000) fprintf(file, "  reset");
+		else fprintf(file, "  $%04X", subroutines[i].second);
+		fprintf(file, " %12llu cycles %6.2f%%\n",
+			static_cast<unsigned long long>(subroutines[i].first), percent(subroutines[i].first, total));
+	}
+}
+
+bool Profiler::writeReport(const std::string filename) {
+	FILE* file = fopen(filename.c_str(), "w");
+	if (file == NULL) {
+		printf("ERROR: Unable to open %s for writing!\n", filename.c_str());
+		return false;
+	}
+	writeReport(file);
+	fclose(file);
+	return true;
+}
+
+bool Profiler::writeCollapsed(const std::string filename) {
+	FILE* file = fopen(filename.c_str(), "w");
+	if (file == NULL) {
+		printf("ERROR: Unable to open %s for writing!\n", filename.c_str());
+		return false;
+	}
+	for (u32 i = 0; i < nodes.size(); i++) {
+		if (nodes[i].cycles == 0) continue;
+		fprintf(file, "%s %llu\n", nodePath(i).c_str(), static_cast<unsigned long long>(nodes[i].cycles));
+	}
+	fclose(file);
+	return true;
+}
+
+std::string Profiler::nodeName(u32 node) {
+	if (node == 0) return "reset";
+	char name[8];
+	snprintf(name, sizeof(name), "$%04X", nodes[node].address);
+	return name;
+}
+
+std::string Profiler::nodePath(u32 node) {
+	std::string path = nodeName(node);
+	while (node != 0) {
+		node = nodes[node].parent;
+		path = nodeName(node) + ";" + path;
+	}
+	return path;
+}
+
+#endif // NES_PROFILER
@@ -0,0 +1,74 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifdef NES_PROFILER
+
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "definitions.h"
+
+/*
+Guest profiler, only built with -DNES_PROFILER (make PROFILE=1). The CPU
+reports every executed opcode with the cycles it took (DMA stalls
+included), which are added up per PC in a flat 64K table and per
+opcode. JSR and RTS walk a call tree whose nodes collect the cycles
+spent directly in them, so the results can be dumped as a report or as
+collapsed stacks for flamegraph.pl.
+*/
+
+class Profiler {
+public:
+	Profiler();
+
+	void record(u16 pc, u8 opcode, unsigned int cycles) {
+		pc_cycles[pc] += cycles;
+		opcode_cycles[opcode] += cycles;
+		opcode_counts[opcode]++;
+		nodes[current].cycles += cycles;
+	}
+
+	// JSR to target, and the RTS that (hopefully) returns from it
+	void call(u16 target);
+	void ret();
+
+	void reset();
+
+	// Hottest PCs, opcodes and subroutines
+	void writeReport(FILE* file);
+	bool writeReport(const std::string filename);
+
+	// One "caller;callee;... cycles" line per call tree node
+	bool writeCollapsed(const std::string filename);
+private:
+	// Games use JSR/RTS as computed jumps too, so calls and returns don't
+	// always pair up. The tree is capped in depth (calls past it are
+	// counted so their returns don't pop the node at the cap) and an RTS
+	// at the root is ignored.
+	static const unsigned int MAX_DEPTH = 256;
+
+	struct Node {
+		u16 address;	// Subroutine entry point
+		u32 parent;
+		unsigned int depth;
+		u64 cycles;		// Spent in this node itself, not its callees
+	};
+
+	u64 pc_cycles[0x10000];
+	u64 opcode_cycles[256];
+	u64 opcode_counts[256];
+
+	std::vector<Node> nodes;
+	std::unordered_map<u64, u32> children;	// (parent << 16 | address) -> node
+	u32 current;
+	unsigned int overflow;	// Calls made at MAX_DEPTH and not returned from yet
+
+	std::string nodeName(u32 node);
+	std::string nodePath(u32 node);
+};
+
+#endif // NES_PROFILER
+
+#endif // PROFILER_H
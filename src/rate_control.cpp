@@ -0,0 +1,89 @@
+#include "rate_control.h"
+
+namespace {
+	const double DEFAULT_MAX_ADJUSTMENT = 0.005;
+
+	// Half full leaves the same room for jitter in both directions
+	const double TARGET_FILL = 0.5;
+
+	// Fill level smoothing, the level jumps by a whole frame of samples on
+	// every push and by a whole device buffer on every callback.
+	const double FILL_SMOOTHING = 0.05;
+
+	// Per frame integral gain, slowly takes out the fill offset a purely
+	// proportional controller leaves when the two clocks really differ.
+	const double INTEGRAL_GAIN = 0.002;
+
+	const unsigned int STATS_FRAMES = 60;
+
+	double clamp(double value, double limit) {
+		if (value > limit) return limit;
+		if (value < -limit) return -limit;
+		return value;
+	}
+}
+
+RateControl::RateControl() {
+	enabled = true;
+	max_adjustment = DEFAULT_MAX_ADJUSTMENT;
+	average_fill = TARGET_FILL;
+	integral = 0.0;
+	window_frames = 0;
+	window_min = 1.0;
+	window_max = 1.0;
+
+	fill = 0.0;
+	smoothed_fill = TARGET_FILL;
+	ratio = 1.0;
+	min_ratio = 1.0;
+	max_ratio = 1.0;
+}
+
+void RateControl::setEnabled(bool on) {
+	enabled = on;
+}
+
+bool RateControl::isEnabled() {
+	return enabled;
+}
+
+void RateControl::setMaxAdjustment(double fraction) {
+	max_adjustment = fraction;
+}
+
+double RateControl::update(size_t fill, size_t capacity) {
+	double level = capacity ? static_cast<double>(fill) / capacity : TARGET_FILL;
+	average_fill += (level - average_fill) * FILL_SMOOTHING;
+
+	// Proportional to the distance from the target (full adjustment at an
+	// empty or full buffer) plus the integral of that distance.
+	double adjust = 1.0;
+	if (enabled) {
+		double error = clamp((TARGET_FILL - average_fill) / TARGET_FILL, 1.0) * max_adjustment;
+		integral = clamp(integral + error * INTEGRAL_GAIN, max_adjustment);
+		adjust = 1.0 + clamp(error + integral, max_adjustment);
+	}
+
+	if (window_frames == 0 || adjust < window_min) window_min = adjust;
+	if (window_frames == 0 || adjust > window_max) window_max = adjust;
+	if (++window_frames >= STATS_FRAMES) {
+		min_ratio.store(window_min, std::memory_order_relaxed);
+		max_ratio.store(window_max, std::memory_order_relaxed);
+		window_frames = 0;
+	}
+
+	this->fill.store(level, std::memory_order_relaxed);
+	smoothed_fill.store(average_fill, std::memory_order_relaxed);
+	ratio.store(adjust, std::memory_order_relaxed);
+	return adjust;
+}
+
+RateStats RateControl::getStats() {
+	RateStats stats;
+	stats.fill = fill.load(std::memory_order_relaxed);
+	stats.average_fill = smoothed_fill.load(std::memory_order_relaxed);
+	stats.ratio = ratio.load(std::memory_order_relaxed);
+	stats.min_ratio = min_ratio.load(std::memory_order_relaxed);
+	stats.max_ratio = max_ratio.load(std::memory_order_relaxed);
+	return stats;
+}
@@ -0,0 +1,60 @@
+#ifndef RATE_CONTROL_H
+#define RATE_CONTROL_H
+
+#include <atomic>
+#include <stddef.h>
+
+/*
+Dynamic audio rate control. The emulation is paced by the host's clock
+and the audio device by its own crystal, so over a long session the
+audio buffer would slowly drain (crackles) or fill up (growing latency,
+then dropped samples). Once per frame the producer reports how full the
+ring buffer is and gets back a multiplier for its output sample rate:
+a little more than 1 when the buffer is running low, a little less
+when it is running full. The adjustment stays within a fraction of a
+percent, far below what can be heard as a pitch change, which lets the
+buffer stay small without underruns.
+*/
+
+struct RateStats {
+	double fill;			// Ring buffer fill, 0 to 1
+	double average_fill;	// Smoothed fill the ratio is based on
+	double ratio;			// Current output rate multiplier
+	double min_ratio;		// Range of the ratio over the last second
+	double max_ratio;
+};
+
+class RateControl {
+public:
+	RateControl();
+
+	void setEnabled(bool on);
+	bool isEnabled();
+
+	// Largest change of the output rate, 0.005 is half a percent
+	void setMaxAdjustment(double fraction);
+
+	// Producer side, once per frame with the fill level halfway between
+	// before and after pushing its samples
+	double update(size_t fill, size_t capacity);
+
+	// Safe to call from any thread
+	RateStats getStats();
+private:
+	bool enabled;
+	double max_adjustment;
+	double average_fill;
+	double integral;
+
+	// Window the published min/max ratio is collected over
+	unsigned int window_frames;
+	double window_min, window_max;
+
+	std::atomic<double> fill;
+	std::atomic<double> smoothed_fill;
+	std::atomic<double> ratio;
+	std::atomic<double> min_ratio;
+	std::atomic<double> max_ratio;
+};
+
+#endif // RATE_CONTROL_H
@@ -0,0 +1,86 @@
+#include "recompiled_library.h"
+
+#include <stdio.h>
+#include <dlfcn.h>
+
+u64 recompiled::hashPRG(Cartridge& cartridge) {
+	u64 hash = 0xCBF29CE484222325ULL;
+	for (unsigned int page = 0x8000; page <= 0xFF00; page += 0x100) {
+		const uint8_t* bytes = cartridge.getPagePointer(page);
+		for (unsigned int i = 0; i < 0x100; i++) {
+			hash ^= bytes[i];
+			hash *= 0x100000001B3ULL;
+		}
+	}
+	return hash;
+}
+
+RecompiledLibrary::RecompiledLibrary() {
+	handle = NULL;
+	entries = 0;
+}
+
+RecompiledLibrary::~RecompiledLibrary() {
+	if (handle) dlclose(handle);
+}
+
+bool RecompiledLibrary::load(const std::string filename, Cartridge& cartridge) {
+	// A bare file name would be looked up in the library path instead
+	std::string path = filename.find('/') == std::string::npos ? "./" + filename : filename;
+	handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (handle == NULL) {
+		printf("ERROR: Unable to load %s: %s\n", filename.c_str(), dlerror());
+		return false;
+	}
+
+	const recompiled::Entry* entry_list = static_cast<const recompiled::Entry*>(dlsym(handle, recompiled::ENTRIES_SYMBOL));
+	const unsigned int* entry_count = static_cast<const unsigned int*>(dlsym(handle, recompiled::ENTRY_COUNT_SYMBOL));
+	const u64* prg_hash = static_cast<const u64*>(dlsym(handle, recompiled::PRG_HASH_SYMBOL));
+	if (entry_list == NULL || entry_count == NULL || prg_hash == NULL) {
+		printf("ERROR: %s isn't a recompiled ROM!\n", filename.c_str());
+		return false;
+	}
+	const unsigned int* format_version = static_cast<const unsigned int*>(dlsym(handle, recompiled::FORMAT_VERSION_SYMBOL));
+	if (format_version == NULL || *format_version != recompiled::FORMAT_VERSION) {
+		printf("ERROR: %s was made by a different version of nes-recompile!\n", filename.c_str());
+		return false;
+	}
+	if (*prg_hash != recompiled::hashPRG(cartridge)) {
+		printf("ERROR: %s was recompiled from a different ROM!\n", filename.c_str());
+		return false;
+	}
+
+	// Everything the generated code reaches into, a size mismatch means
+	// the library saw other NES_* options or other headers
+	const struct {
+		const char* symbol;
+		unsigned int size;
+	} layouts[] = {
+		{recompiled::CPU_SIZE_SYMBOL, sizeof(CPU)},
+		{recompiled::MEMORY_SIZE_SYMBOL, sizeof(Memory)},
+		{recompiled::APU_SIZE_SYMBOL, sizeof(APU)},
+		{recompiled::CARTRIDGE_SIZE_SYMBOL, sizeof(Cartridge)}
+	};
+	for (auto& layout : layouts) {
+		const unsigned int* size = static_cast<const unsigned int*>(dlsym(handle, layout.symbol));
+		if (size == NULL || *size != layout.size) {
+			printf("ERROR: %s was built against a different emulator build!\n", filename.c_str());
+			return false;
+		}
+	}
+
+	table.assign(0x8000, NULL);
+	for (unsigned int i = 0; i < *entry_count; i++) {
+		if (entry_list[i].address >= 0x8000) table[entry_list[i].address - 0x8000] = entry_list[i].block;
+	}
+	entries = *entry_count;
+	return true;
+}
+
+const RecompiledBlock* RecompiledLibrary::getTable() {
+	return table.empty() ? NULL : &table[0];
+}
+
+unsigned int RecompiledLibrary::getEntryCount() {
+	return entries;
+}
@@ -0,0 +1,60 @@
+#ifndef RECOMPILED_LIBRARY_H
+#define RECOMPILED_LIBRARY_H
+
+#include <string>
+#include <vector>
+
+#include "cartridge.h"
+#include "cpu.h"
+
+/*
+Shared object the recompiler (tools/recompiler.cpp) built for one ROM.
+It exports the addresses it has code for, a hash of the PRG ROM it was
+built from, the version of the code generator and the sizes of the
+classes its code inlines. A library built from another ROM, by another
+version of the recompiler or against a differently configured emulator
+is refused instead of running the wrong code.
+*/
+
+namespace recompiled {
+	// What every generated library exports, all extern "C"
+	struct Entry {
+		u16 address;
+		RecompiledBlock block;
+	};
+	const char* const ENTRIES_SYMBOL = "nes_recompiled_entries";		// const Entry[]
+	const char* const ENTRY_COUNT_SYMBOL = "nes_recompiled_entry_count";	// const unsigned int
+	const char* const PRG_HASH_SYMBOL = "nes_recompiled_prg_hash";		// const u64
+	const char* const FORMAT_VERSION_SYMBOL = "nes_recompiled_format_version";	// const unsigned int
+	const char* const CPU_SIZE_SYMBOL = "nes_recompiled_cpu_size";		// const unsigned int, sizeof(CPU)
+	const char* const MEMORY_SIZE_SYMBOL = "nes_recompiled_memory_size";	// const unsigned int, sizeof(Memory)
+	const char* const APU_SIZE_SYMBOL = "nes_recompiled_apu_size";		// const unsigned int, sizeof(APU)
+	const char* const CARTRIDGE_SIZE_SYMBOL = "nes_recompiled_cartridge_size";	// const unsigned int, sizeof(Cartridge)
+
+	// Bump whenever the generated code changes, or what it relies on from
+	// the emulator's headers changes in a way the sizes don't show
+	const unsigned int FORMAT_VERSION = 2;
+
+	// FNV-1a over $8000-$FFFF as the CPU sees it
+	u64 hashPRG(Cartridge& cartridge);
+}
+
+class RecompiledLibrary {
+public:
+	RecompiledLibrary();
+	~RecompiledLibrary();
+
+	// Returns false and prints an error if the library can't be loaded or
+	// wasn't built for this cartridge
+	bool load(const std::string filename, Cartridge& cartridge);
+
+	// For CPU::set_recompiled(), valid while the library is loaded
+	const RecompiledBlock* getTable();
+	unsigned int getEntryCount();
+private:
+	void* handle;
+	std::vector<RecompiledBlock> table;
+	unsigned int entries;
+};
+
+#endif // RECOMPILED_LIBRARY_H
@@ -36,6 +36,9 @@ public:
 	void set_overflow(bool on) { reg_value = bitwise::set_bit_to(reg_value, 6, on); }
 	void set_negative(bool on) { reg_value = bitwise::set_bit_to(reg_value, 7, on); }
 
+	// Replaces the bits in mask with flags, in one go
+	void set_flags(u8 mask, u8 flags) { reg_value = (reg_value & ~mask) | flags; }
+
 	bool get_carry() { return bitwise::check_bit(reg_value, 0); }
 	bool get_zero() { return bitwise::check_bit(reg_value, 1); }
 	bool get_interrupt_disable() { return bitwise::check_bit(reg_value, 2); }
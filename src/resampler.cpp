@@ -0,0 +1,147 @@
+#include "resampler.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESAMPLER_X86
+#endif
+
+namespace {
+	const double PI = 3.14159265358979323846;
+	const int FRACTION_BITS = 32;
+
+	struct QualityPreset {
+		int taps;
+		double cutoff;	// Fraction of the lower of the two Nyquist frequencies
+	};
+
+	const QualityPreset PRESETS[3] = {
+		{ 8, 0.80 },
+		{ 16, 0.90 },
+		{ 32, 0.95 }
+	};
+
+	float dot_scalar(const float* samples, const float* coefficients, int taps) {
+		float sum = 0.0f;
+		for (int i = 0; i < taps; i++) sum += samples[i] * coefficients[i];
+		return sum;
+	}
+
+#ifdef RESAMPLER_X86
+	float dot_sse(const float* samples, const float* coefficients, int taps) {
+		__m128 sum = _mm_setzero_ps();
+		for (int i = 0; i < taps; i += 4)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(coefficients + i)));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+		return _mm_cvtss_f32(sum);
+	}
+
+	__attribute__((target("avx2,fma")))
+	float dot_avx2(const float* samples, const float* coefficients, int taps) {
+		__m256 sum = _mm256_setzero_ps();
+		for (int i = 0; i < taps; i += 8)
+			sum = _mm256_fmadd_ps(_mm256_loadu_ps(samples + i), _mm256_loadu_ps(coefficients + i), sum);
+		__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+		half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+		half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 0x55));
+		return _mm_cvtss_f32(half);
+	}
+#endif
+}
+
+Resampler::Resampler(double input_rate, double output_rate, ResampleQuality quality) {
+	const QualityPreset& preset = PRESETS[static_cast<int>(quality)];
+	taps = preset.taps;
+	step = static_cast<u64>(input_rate / output_rate * (1ULL << FRACTION_BITS) + 0.5);
+	position = 0;
+
+	// Downsampling has to cut below the output's Nyquist frequency
+	double cutoff = preset.cutoff * (output_rate < input_rate ? output_rate / input_rate : 1.0);
+
+	// Blackman windowed sinc, row p is shifted right by p/PHASES of an
+	// input sample and normalized to unity gain.
+	coefficients.resize(PHASES * taps);
+	for (int phase = 0; phase < PHASES; phase++) {
+		float* row = &coefficients[phase * taps];
+		double sum = 0.0;
+		for (int tap = 0; tap < taps; tap++) {
+			double x = tap - (taps / 2 - 1) - static_cast<double>(phase) / PHASES;
+			double sinc = x == 0.0 ? 1.0 : sin(PI * cutoff * x) / (PI * cutoff * x);
+			double w = (x + taps / 2) / taps;
+			double window = 0.42 - 0.5 * cos(2.0 * PI * w) + 0.08 * cos(4.0 * PI * w);
+			row[tap] = static_cast<float>(sinc * window);
+			sum += row[tap];
+		}
+		for (int tap = 0; tap < taps; tap++) row[tap] = static_cast<float>(row[tap] / sum);
+	}
+
+	// Start with a filter's worth of silence so the first input sample
+	// lines up with the first output sample.
+	history.assign(taps / 2 - 1, 0.0f);
+
+	if (!setKernel(ResampleKernel::AVX2) && !setKernel(ResampleKernel::SSE)) setKernel(ResampleKernel::SCALAR);
+}
+
+void Resampler::process(const s16* in, size_t count, std::vector<s16>& out) {
+	size_t start = history.size();
+	history.resize(start + count);
+	for (size_t i = 0; i < count; i++) history[start + i] = in[i];
+
+	size_t available = history.size();
+	while ((position >> FRACTION_BITS) + taps <= available) {
+		size_t index = static_cast<size_t>(position >> FRACTION_BITS);
+		int phase = static_cast<int>(position >> (FRACTION_BITS - PHASE_BITS)) & (PHASES - 1);
+		float sample = dot(&history[index], &coefficients[phase * taps], taps);
+
+		if (sample > 32767.0f) sample = 32767.0f;
+		if (sample < -32768.0f) sample = -32768.0f;
+		out.push_back(static_cast<s16>(lrintf(sample)));
+		position += step;
+	}
+
+	// Drop the input no future output sample reaches back to
+	size_t consumed = static_cast<size_t>(position >> FRACTION_BITS);
+	if (consumed > available) consumed = available;
+	history.erase(history.begin(), history.begin() + consumed);
+	position -= static_cast<u64>(consumed) << FRACTION_BITS;
+}
+
+bool Resampler::setKernel(ResampleKernel kernel) {
+	switch (kernel) {
+		case ResampleKernel::SCALAR:
+			dot = dot_scalar;
+			break;
+#ifdef RESAMPLER_X86
+		case ResampleKernel::SSE:
+			if (!__builtin_cpu_supports("sse")) return false;
+			dot = dot_sse;
+			break;
+		case ResampleKernel::AVX2:
+			if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma")) return false;
+			dot = dot_avx2;
+			break;
+#endif
+		default:
+			return false;
+	}
+	this->kernel = kernel;
+	return true;
+}
+
+ResampleKernel Resampler::getKernel() {
+	return kernel;
+}
+
+int Resampler::getTaps() {
+	return taps;
+}
+
+bool Resampler::parseQuality(const std::string& name, ResampleQuality& quality) {
+	if (name == "low") quality = ResampleQuality::LOW;
+	else if (name == "medium") quality = ResampleQuality::MEDIUM;
+	else if (name == "high") quality = ResampleQuality::HIGH;
+	else return false;
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+
+// Taps per output sample (8, 16 or 32) and how close to Nyquist the
+// passband reaches.
+enum class ResampleQuality {
+	LOW, MEDIUM, HIGH
+};
+
+enum class ResampleKernel {
+	SCALAR, SSE, AVX2
+};
+
+/*
+Windowed-sinc polyphase resampler for converting APU output to any host
+or file sample rate. The filter is precomputed for 256 sub-sample
+phases, so every output sample is a single dot product of the input
+history with the row of the nearest phase. That dot product is all the
+work there is and runs on SSE or AVX2/FMA when the host has it.
+*/
+
+class Resampler {
+public:
+	static const int PHASE_BITS = 8;
+	static const int PHASES = 1 << PHASE_BITS;
+
+	Resampler(double input_rate, double output_rate, ResampleQuality quality = ResampleQuality::MEDIUM);
+
+	// Consumes count input samples and appends the output samples they
+	// complete to out. Input not yet covered by a whole filter is kept
+	// for the next call.
+	void process(const s16* in, size_t count, std::vector<s16>& out);
+
+	// Picks the dot product kernel, the best one the host supports is
+	// used by default. Returns false if the host can't run it.
+	bool setKernel(ResampleKernel kernel);
+	ResampleKernel getKernel();
+
+	int getTaps();
+
+	static bool parseQuality(const std::string& name, ResampleQuality& quality);
+private:
+	typedef float (*DotProduct)(const float* samples, const float* coefficients, int taps);
+
+	int taps;
+	std::vector<float> coefficients;	// PHASES rows of taps
+	std::vector<float> history;
+
+	// Input samples per output sample and the position of the next output
+	// sample in history, both 32.32 fixed point.
+	u64 step;
+	u64 position;
+
+	ResampleKernel kernel;
+	DotProduct dot;
+};
+
+#endif // RESAMPLER_H
@@ -0,0 +1,65 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+#include "definitions.h"
+
+/*
+Wait-free single producer/single consumer ring buffer. Both sides only
+ever load the other side's index and store their own, so neither can be
+blocked by the other (the audio callback must never wait on the
+emulation thread). Pushes that don't fit and pops of more than is
+available are cut short rather than waiting.
+*/
+
+template <typename T>
+class RingBuffer {
+public:
+	// Capacity is rounded up to a power of two
+	RingBuffer(size_t capacity) : head(0), tail(0) {
+		size_t size = 1;
+		while (size < capacity) size <<= 1;
+		buffer.resize(size);
+		mask = size - 1;
+	}
+
+	// Producer side, returns how many values were written
+	size_t push(const T* values, size_t count) {
+		size_t write = head.load(std::memory_order_relaxed);
+		size_t read = tail.load(std::memory_order_acquire);
+		size_t free = buffer.size() - (write - read);
+		if (count > free) count = free;
+		for (size_t i = 0; i < count; i++) buffer[(write + i) & mask] = values[i];
+		head.store(write + count, std::memory_order_release);
+		return count;
+	}
+
+	// Consumer side, returns how many values were read
+	size_t pop(T* values, size_t count) {
+		size_t read = tail.load(std::memory_order_relaxed);
+		size_t write = head.load(std::memory_order_acquire);
+		if (count > write - read) count = write - read;
+		for (size_t i = 0; i < count; i++) values[i] = buffer[(read + i) & mask];
+		tail.store(read + count, std::memory_order_release);
+		return count;
+	}
+
+	// Either side, may be stale by the time it returns
+	size_t size() const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+	size_t capacity() const { return buffer.size(); }
+
+private:
+	std::vector<T> buffer;
+	size_t mask;
+
+	// Kept on separate cache lines so the two threads don't fight over one
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,333 @@
+#include "scaler.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// Neighbouring pixel with the coordinates clamped to the frame of a neighbouring pixel
+	inline int index(int width, int height, int x, int y) {
+		if (x < 0) x = 0;
+		if (x >= width) x = width - 1;
+		if (y < 0) y = 0;
+		if (y >= height) y = height - 1;
+		return y * width + x;
+	}
+
+	inline u32 at(const u32* pixels, int width, int height, int x, int y) {
+		return pixels[index(width, height, x, y)];
+	}
+
+	// 50/50 mix of two ARGB colours
+	inline u32 blend(u32 a, u32 b) {
+		return (((a ^ b) & 0xFEFEFEFE) >> 1) + (a & b);
+	}
+
+	// Weighted mix of three ARGB colours, the weights add up to 8. Two
+	// channels at a time in 16 bit lanes.
+	inline u32 mix(u32 a, u32 wa, u32 b, u32 wb, u32 c, u32 wc) {
+		u32 rb = ((a & 0x00FF00FF) * wa + (b & 0x00FF00FF) * wb + (c & 0x00FF00FF) * wc) >> 3;
+		u32 ag = (((a >> 8) & 0x00FF00FF) * wa + ((b >> 8) & 0x00FF00FF) * wb + ((c >> 8) & 0x00FF00FF) * wc) >> 3;
+		return (rb & 0x00FF00FF) | ((ag & 0x00FF00FF) << 8);
+	}
+
+	// hqx treats two colours as different past these YUV differences
+	// (in the units of Scaler::YUV)
+	const int HQX_Y_THRESHOLD = 48 * 1000;
+	const int HQX_U_THRESHOLD = 7 * 1000;
+	const int HQX_V_THRESHOLD = 6 * 1000;
+
+	void scale2x_pixel(const u32* pixels, int width, int height, int x, int y, u32* out, int out_width) {
+		u32 B = at(pixels, width, height, x, y - 1);
+		u32 D = at(pixels, width, height, x - 1, y);
+		u32 E = pixels[y * width + x];
+		u32 F = at(pixels, width, height, x + 1, y);
+		u32 H = at(pixels, width, height, x, y + 1);
+
+		u32* row = out + (y * 2) * out_width + x * 2;
+		if (B != H && D != F) {
+			row[0] = D == B ? D : E;
+			row[1] = B == F ? F : E;
+			row[out_width] = D == H ? D : E;
+			row[out_width + 1] = H == F ? F : E;
+		} else {
+			row[0] = row[1] = row[out_width] = row[out_width + 1] = E;
+		}
+	}
+}
+
+Scaler::Scaler(ThreadPool& pool) : pool(pool) {
+	filter = ScaleFilter::NONE;
+	filter_time = 0.0;
+}
+
+void Scaler::setFilter(ScaleFilter filter) {
+	this->filter = filter;
+}
+
+ScaleFilter Scaler::getFilter() {
+	return filter;
+}
+
+int Scaler::getScale() {
+	switch (filter) {
+		case ScaleFilter::SCALE2X: return 2;
+		case ScaleFilter::SCALE3X: return 3;
+		case ScaleFilter::XBR2X: return 2;
+		case ScaleFilter::HQ2X: return 2;
+		case ScaleFilter::HQ3X: return 3;
+		default: return 1;
+	}
+}
+
+double Scaler::getFilterTime() {
+	return filter_time;
+}
+
+bool Scaler::parseFilter(const std::string& name, ScaleFilter& filter) {
+	if (name == "none") filter = ScaleFilter::NONE;
+	else if (name == "scale2x") filter = ScaleFilter::SCALE2X;
+	else if (name == "scale3x") filter = ScaleFilter::SCALE3X;
+	else if (name == "xbr2x") filter = ScaleFilter::XBR2X;
+	else if (name == "hq2x") filter = ScaleFilter::HQ2X;
+	else if (name == "hq3x") filter = ScaleFilter::HQ3X;
+	else return false;
+	return true;
+}
+
+const u32* Scaler::apply(const u32* pixels, int width, int height) {
+	if (filter == ScaleFilter::NONE) {
+		filter_time = 0.0;
+		return pixels;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int scale = getScale();
+	output.resize(width * scale * height * scale);
+
+	// xBR and hqx compare colours in YUV, convert every pixel once up front
+	if (filter == ScaleFilter::XBR2X || filter == ScaleFilter::HQ2X || filter == ScaleFilter::HQ3X) {
+		yuv.resize(width * height);
+		pool.runSlices(height, [&](int first_row, int end_row) {
+			for (int i = first_row * width; i < end_row * width; i++) {
+				int r = (pixels[i] >> 16) & 0xFF, g = (pixels[i] >> 8) & 0xFF, b = pixels[i] & 0xFF;
+				yuv[i].y = 299 * r + 587 * g + 114 * b;
+				yuv[i].u = -169 * r - 331 * g + 500 * b;
+				yuv[i].v = 500 * r - 419 * g - 81 * b;
+			}
+		});
+	}
+
+	pool.runSlices(height, [&](int first_row, int end_row) {
+		switch (filter) {
+			case ScaleFilter::SCALE2X: scale2x(pixels, width, height, first_row, end_row); break;
+			case ScaleFilter::SCALE3X: scale3x(pixels, width, height, first_row, end_row); break;
+			case ScaleFilter::XBR2X: xbr2x(pixels, width, height, first_row, end_row); break;
+			case ScaleFilter::HQ2X: hq2x(pixels, width, height, first_row, end_row); break;
+			case ScaleFilter::HQ3X: hq3x(pixels, width, height, first_row, end_row); break;
+			default: break;
+		}
+	});
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	filter_time = elapsed.count();
+	return output.data();
+}
+
+void Scaler::scale2x(const u32* pixels, int width, int height, int first_row, int end_row) {
+	int out_width = width * 2;
+	u32* out = output.data();
+
+	for (int y = first_row; y < end_row; y++) {
+		int x = 0;
+		scale2x_pixel(pixels, width, height, x++, y, out, out_width);
+
+#ifdef __SSE2__
+		// Four pixels at a time, the first and last columns need clamping
+		// so they go through the scalar path.
+		const u32* up = pixels + (y > 0 ? y - 1 : y) * width;
+		const u32* mid = pixels + y * width;
+		const u32* down = pixels + (y < height - 1 ? y + 1 : y) * width;
+		u32* top = out + (y * 2) * out_width;
+		u32* bottom = top + out_width;
+		const __m128i ones = _mm_set1_epi32(-1);
+
+		for (; x + 4 < width; x += 4) {
+			__m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(up + x));
+			__m128i D = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + x - 1));
+			__m128i E = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + x));
+			__m128i F = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + x + 1));
+			__m128i H = _mm_loadu_si128(reinterpret_cast<const __m128i*>(down + x));
+
+			__m128i edge = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F)), ones);
+			__m128i use_d0 = _mm_and_si128(edge, _mm_cmpeq_epi32(D, B));
+			__m128i use_f1 = _mm_and_si128(edge, _mm_cmpeq_epi32(B, F));
+			__m128i use_d2 = _mm_and_si128(edge, _mm_cmpeq_epi32(D, H));
+			__m128i use_f3 = _mm_and_si128(edge, _mm_cmpeq_epi32(H, F));
+
+			__m128i E0 = _mm_or_si128(_mm_and_si128(use_d0, D), _mm_andnot_si128(use_d0, E));
+			__m128i E1 = _mm_or_si128(_mm_and_si128(use_f1, F), _mm_andnot_si128(use_f1, E));
+			__m128i E2 = _mm_or_si128(_mm_and_si128(use_d2, D), _mm_andnot_si128(use_d2, E));
+			__m128i E3 = _mm_or_si128(_mm_and_si128(use_f3, F), _mm_andnot_si128(use_f3, E));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(top + x * 2), _mm_unpacklo_epi32(E0, E1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(top + x * 2 + 4), _mm_unpackhi_epi32(E0, E1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(bottom + x * 2), _mm_unpacklo_epi32(E2, E3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(bottom + x * 2 + 4), _mm_unpackhi_epi32(E2, E3));
+		}
+#endif
+
+		for (; x < width; x++) scale2x_pixel(pixels, width, height, x, y, out, out_width);
+	}
+}
+
+void Scaler::scale3x(const u32* pixels, int width, int height, int first_row, int end_row) {
+	int out_width = width * 3;
+
+	for (int y = first_row; y < end_row; y++) {
+		for (int x = 0; x < width; x++) {
+			u32 A = at(pixels, width, height, x - 1, y - 1);
+			u32 B = at(pixels, width, height, x, y - 1);
+			u32 C = at(pixels, width, height, x + 1, y - 1);
+			u32 D = at(pixels, width, height, x - 1, y);
+			u32 E = pixels[y * width + x];
+			u32 F = at(pixels, width, height, x + 1, y);
+			u32 G = at(pixels, width, height, x - 1, y + 1);
+			u32 H = at(pixels, width, height, x, y + 1);
+			u32 I = at(pixels, width, height, x + 1, y + 1);
+
+			u32* row0 = output.data() + (y * 3) * out_width + x * 3;
+			u32* row1 = row0 + out_width;
+			u32* row2 = row1 + out_width;
+			if (B != H && D != F) {
+				row0[0] = D == B ? D : E;
+				row0[1] = (D == B && E != C) || (B == F && E != A) ? B : E;
+				row0[2] = B == F ? F : E;
+				row1[0] = (D == B && E != G) || (D == H && E != A) ? D : E;
+				row1[1] = E;
+				row1[2] = (B == F && E != I) || (H == F && E != C) ? F : E;
+				row2[0] = D == H ? D : E;
+				row2[1] = (D == H && E != I) || (H == F && E != G) ? H : E;
+				row2[2] = H == F ? F : E;
+			} else {
+				row0[0] = row0[1] = row0[2] = E;
+				row1[0] = row1[1] = row1[2] = E;
+				row2[0] = row2[1] = row2[2] = E;
+			}
+		}
+	}
+}
+
+int Scaler::distance(int a, int b) {
+	// Weighted YUV distance between two pixels, as used by xBR
+	return (abs(yuv[a].y - yuv[b].y) * 48 + abs(yuv[a].u - yuv[b].u) * 7 + abs(yuv[a].v - yuv[b].v) * 6) / 1000;
+}
+
+void Scaler::xbr2x(const u32* pixels, int width, int height, int first_row, int end_row) {
+	int out_width = width * 2;
+
+	for (int y = first_row; y < end_row; y++) {
+		for (int x = 0; x < width; x++) {
+			int E = y * width + x;
+			u32* out = output.data() + (y * 2) * out_width + x * 2;
+
+			// Each output corner runs the bottom-right 2xBR rule on a
+			// mirrored neighbourhood (the rule is symmetric on its diagonal).
+			for (int corner = 0; corner < 4; corner++) {
+				int sx = (corner & 1) ? 1 : -1;
+				int sy = (corner & 2) ? 1 : -1;
+				#define XBR_PIXEL(dx, dy) index(width, height, x + (dx) * sx, y + (dy) * sy)
+				int B = XBR_PIXEL(0, -1), C = XBR_PIXEL(1, -1);
+				int D = XBR_PIXEL(-1, 0), F = XBR_PIXEL(1, 0), F4 = XBR_PIXEL(2, 0);
+				int G = XBR_PIXEL(-1, 1), H = XBR_PIXEL(0, 1), I = XBR_PIXEL(1, 1), I4 = XBR_PIXEL(2, 1);
+				int H5 = XBR_PIXEL(0, 2), I5 = XBR_PIXEL(1, 2);
+				#undef XBR_PIXEL
+
+				u32 result = pixels[E];
+				if (pixels[F] != pixels[E] || pixels[H] != pixels[E]) {
+					int e = distance(E, C) + distance(E, G) + distance(I, F4) + distance(I, H5) + 4 * distance(H, F);
+					int i = distance(H, D) + distance(H, I5) + distance(F, I4) + distance(F, B) + 4 * distance(E, I);
+					if (e < i) result = blend(pixels[E], pixels[distance(E, F) <= distance(E, H) ? F : H]);
+				}
+				out[((corner & 2) ? out_width : 0) + (corner & 1)] = result;
+			}
+		}
+	}
+}
+
+bool Scaler::differ(int a, int b) {
+	return abs(yuv[a].y - yuv[b].y) > HQX_Y_THRESHOLD || abs(yuv[a].u - yuv[b].u) > HQX_U_THRESHOLD ||
+		abs(yuv[a].v - yuv[b].v) > HQX_V_THRESHOLD;
+}
+
+// Output pixel in the corner of e towards the diagonal neighbour a, with b
+// the vertical and d the horizontal neighbour on that side. The hqx
+// interpolation rules: lean into the neighbours when an edge runs across
+// the corner, otherwise bleed a little of whichever neighbour differs.
+u32 Scaler::hqCorner(const u32* pixels, int e, int a, int b, int d) {
+	bool differ_b = differ(e, b), differ_d = differ(e, d);
+	if (differ_b && differ_d) {
+		if (differ(b, d)) return mix(pixels[e], 6, pixels[b], 1, pixels[d], 1);
+		if (!differ(a, b)) return mix(pixels[e], 2, pixels[b], 3, pixels[d], 3);
+		return mix(pixels[e], 4, pixels[b], 2, pixels[d], 2);
+	}
+	if (differ_b) return mix(pixels[e], 6, pixels[b], 2, 0, 0);
+	if (differ_d) return mix(pixels[e], 6, pixels[d], 2, 0, 0);
+	if (differ(e, a)) return mix(pixels[e], 6, pixels[a], 2, 0, 0);
+	return pixels[e];
+}
+
+// hq3x's output pixel between the two corners next to b, d1 and d2 being
+// the neighbours beside e on either side of it
+u32 Scaler::hqEdge(const u32* pixels, int e, int b, int d1, int d2) {
+	if (!differ(e, b)) return pixels[e];
+	bool edge = (differ(e, d1) && !differ(b, d1)) || (differ(e, d2) && !differ(b, d2));
+	return edge ? mix(pixels[e], 6, pixels[b], 2, 0, 0) : mix(pixels[e], 7, pixels[b], 1, 0, 0);
+}
+
+void Scaler::hq2x(const u32* pixels, int width, int height, int first_row, int end_row) {
+	int out_width = width * 2;
+
+	for (int y = first_row; y < end_row; y++) {
+		for (int x = 0; x < width; x++) {
+			int A = index(width, height, x - 1, y - 1), B = index(width, height, x, y - 1), C = index(width, height, x + 1, y - 1);
+			int D = index(width, height, x - 1, y), E = y * width + x, F = index(width, height, x + 1, y);
+			int G = index(width, height, x - 1, y + 1), H = index(width, height, x, y + 1), I = index(width, height, x + 1, y + 1);
+
+			u32* row0 = output.data() + (y * 2) * out_width + x * 2;
+			u32* row1 = row0 + out_width;
+			row0[0] = hqCorner(pixels, E, A, B, D);
+			row0[1] = hqCorner(pixels, E, C, B, F);
+			row1[0] = hqCorner(pixels, E, G, H, D);
+			row1[1] = hqCorner(pixels, E, I, H, F);
+		}
+	}
+}
+
+void Scaler::hq3x(const u32* pixels, int width, int height, int first_row, int end_row) {
+	int out_width = width * 3;
+
+	for (int y = first_row; y < end_row; y++) {
+		for (int x = 0; x < width; x++) {
+			int A = index(width, height, x - 1, y - 1), B = index(width, height, x, y - 1), C = index(width, height, x + 1, y - 1);
+			int D = index(width, height, x - 1, y), E = y * width + x, F = index(width, height, x + 1, y);
+			int G = index(width, height, x - 1, y + 1), H = index(width, height, x, y + 1), I = index(width, height, x + 1, y + 1);
+
+			u32* row0 = output.data() + (y * 3) * out_width + x * 3;
+			u32* row1 = row0 + out_width;
+			u32* row2 = row1 + out_width;
+			row0[0] = hqCorner(pixels, E, A, B, D);
+			row0[1] = hqEdge(pixels, E, B, D, F);
+			row0[2] = hqCorner(pixels, E, C, B, F);
+			row1[0] = hqEdge(pixels, E, D, B, H);
+			row1[1] = pixels[E];
+			row1[2] = hqEdge(pixels, E, F, B, H);
+			row2[0] = hqCorner(pixels, E, G, H, D);
+			row2[1] = hqEdge(pixels, E, H, D, F);
+			row2[2] = hqCorner(pixels, E, I, H, F);
+		}
+	}
+}
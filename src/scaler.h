@@ -0,0 +1,61 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "thread_pool.h"
+
+enum class ScaleFilter {
+	NONE, SCALE2X, SCALE3X, XBR2X, HQ2X, HQ3X
+};
+
+/*
+Post-processing upscaler that runs after the framebuffer has been
+converted to pixels. Each filter works on horizontal slices of the
+frame spread across a thread pool, and the time taken for the last
+frame is kept for stats.
+*/
+
+class Scaler {
+public:
+	Scaler(ThreadPool& pool);
+
+	void setFilter(ScaleFilter filter);
+	ScaleFilter getFilter();
+	int getScale();
+
+	// Scales an ARGB8888 frame, returns the scaled pixels (or the input
+	// itself with no filter set). Output is width*scale by height*scale.
+	const u32* apply(const u32* pixels, int width, int height);
+
+	// Milliseconds spent in the last apply()
+	double getFilterTime();
+
+	static bool parseFilter(const std::string& name, ScaleFilter& filter);
+private:
+	ThreadPool& pool;
+	ScaleFilter filter;
+	std::vector<u32> output;
+	double filter_time;
+
+	// Per pixel YUV (times 1000), only filled for xBR and hqx
+	struct YUV {
+		int y, u, v;
+	};
+	std::vector<YUV> yuv;
+
+	int distance(int a, int b);
+	bool differ(int a, int b);
+	u32 hqCorner(const u32* pixels, int e, int a, int b, int d);
+	u32 hqEdge(const u32* pixels, int e, int b, int d1, int d2);
+
+	void scale2x(const u32* pixels, int width, int height, int first_row, int end_row);
+	void scale3x(const u32* pixels, int width, int height, int first_row, int end_row);
+	void xbr2x(const u32* pixels, int width, int height, int first_row, int end_row);
+	void hq2x(const u32* pixels, int width, int height, int first_row, int end_row);
+	void hq3x(const u32* pixels, int width, int height, int first_row, int end_row);
+};
+
+#endif // SCALER_H
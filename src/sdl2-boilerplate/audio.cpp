@@ -0,0 +1,60 @@
+#include "audio.h"
+
+#include <stdio.h>
+
+Audio::Audio(RingBuffer<int16_t>& samples, int sample_rate, int buffer_samples) : samples(samples) {
+	this->sampleRate = sample_rate;
+	this->lastSample = 0;
+	this->underruns = 0;
+
+	SDL_InitSubSystem(SDL_INIT_AUDIO);
+
+	SDL_AudioSpec wanted, obtained;
+	SDL_memset(&wanted, 0, sizeof(wanted));
+	wanted.freq = sample_rate;
+	wanted.format = AUDIO_S16SYS;
+	wanted.channels = 1;
+	wanted.samples = buffer_samples;
+	wanted.callback = Audio::callback;
+	wanted.userdata = this;
+
+	this->device = SDL_OpenAudioDevice(NULL, 0, &wanted, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+	if (this->device == 0) {
+		printf("ERROR: Unable to open audio device: %s\n", SDL_GetError());
+		return;
+	}
+	this->sampleRate = obtained.freq;
+}
+
+Audio::~Audio() {
+	if (this->device) SDL_CloseAudioDevice(this->device);
+}
+
+bool Audio::isOpen() {
+	return this->device != 0;
+}
+
+int Audio::getSampleRate() {
+	return this->sampleRate;
+}
+
+void Audio::pause(bool on) {
+	if (this->device) SDL_PauseAudioDevice(this->device, on ? 1 : 0);
+}
+
+unsigned long Audio::getUnderruns() {
+	return this->underruns;
+}
+
+void Audio::callback(void* userdata, Uint8* stream, int length) {
+	static_cast<Audio*>(userdata)->fill(reinterpret_cast<int16_t*>(stream), length / sizeof(int16_t));
+}
+
+void Audio::fill(int16_t* out, int count) {
+	int read = static_cast<int>(this->samples.pop(out, count));
+	if (read > 0) this->lastSample = out[read - 1];
+	if (read == count) return;
+
+	this->underruns++;
+	for (int i = read; i < count; i++) out[i] = this->lastSample;
+}
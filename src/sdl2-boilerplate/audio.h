@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <atomic>
+
+#include "../ring_buffer.h"
+
+/*
+Mono 16-bit output device, fed from a ring buffer by SDL's audio thread.
+The callback never locks or waits, if the producer falls behind the rest
+of the buffer is filled by holding the last sample.
+*/
+
+class Audio {
+public:
+	Audio(RingBuffer<int16_t>& samples, int sample_rate, int buffer_samples);
+	~Audio();
+
+	bool isOpen();
+
+	// The rate the device actually opened with, may differ from the one
+	// asked for.
+	int getSampleRate();
+
+	void pause(bool on);
+
+	// Callbacks that ran out of samples
+	unsigned long getUnderruns();
+private:
+	RingBuffer<int16_t>& samples;
+	SDL_AudioDeviceID device;
+	int sampleRate;
+
+	int16_t lastSample;
+	std::atomic<unsigned long> underruns;
+
+	static void callback(void* userdata, Uint8* stream, int length);
+	void fill(int16_t* out, int count);
+};
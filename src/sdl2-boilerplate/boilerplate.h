@@ -1,5 +1,6 @@
-// Link graphics and input classes into a single file
+// Link graphics, input and audio classes into a single file
 #pragma once
 
 #include "graphics.h"
-#include "input.h"
\ No newline at end of file
+#include "input.h"
+#include "audio.h"
\ No newline at end of file
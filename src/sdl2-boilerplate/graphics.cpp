@@ -1,12 +1,29 @@
 #include "graphics.h"
 
-Graphics::Graphics(std::string title, int window_width, int window_height) {
+#include <string.h>
+
+namespace {
+	const Uint32 STATS_INTERVAL_MS = 1000;
+}
+
+Graphics::Graphics(std::string title, int window_width, int window_height, bool vsync) {
+	this->title = title;
+	this->frame_texture = NULL;
+	this->frame_width = 0;
+	this->frame_height = 0;
+	this->upload_ticks = 0;
+	this->present_ticks = 0;
+	this->stats_frames = 0;
+	this->upload_time = 0.0;
+	this->present_time = 0.0;
+
 	SDL_Init(SDL_INIT_EVERYTHING);
 	IMG_Init(IMG_INIT_PNG);
 	this->window = SDL_CreateWindow(title.c_str(), SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_FULLSCREEN_DESKTOP);
-	this->renderer = SDL_CreateRenderer(this->window, -1, SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_ACCELERATED);
+	this->renderer = SDL_CreateRenderer(this->window, -1, (vsync ? SDL_RENDERER_PRESENTVSYNC : 0) | SDL_RENDERER_ACCELERATED);
 	SDL_RenderSetLogicalSize(renderer, window_width, window_height);
 	SDL_ShowCursor(SDL_FALSE);
+	this->stats_start = SDL_GetTicks();
 }
 
 Graphics::~Graphics() {
@@ -14,6 +31,7 @@ Graphics::~Graphics() {
 		i != this->sprite_sheets.end(); i++) {
 		SDL_DestroyTexture(i->second);
 	}
+	if (this->frame_texture) SDL_DestroyTexture(this->frame_texture);
 
 	SDL_DestroyWindow(this->window);
 	SDL_DestroyRenderer(this->renderer);
@@ -65,4 +83,78 @@ void Graphics::setDrawColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
 
 void Graphics::destroyTexture(SDL_Texture* texture) {
 	SDL_DestroyTexture(texture);
+}
+
+void Graphics::createFrameTexture(int width, int height) {
+	if (this->frame_texture) SDL_DestroyTexture(this->frame_texture);
+	this->frame_texture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_ARGB8888,
+		SDL_TEXTUREACCESS_STREAMING, width, height);
+	if (this->frame_texture == NULL) printf("Could not create frame texture: %s\n", SDL_GetError());
+	this->frame_width = width;
+	this->frame_height = height;
+}
+
+void Graphics::presentFrame(const uint32_t* pixels) {
+	if (this->frame_texture == NULL) return;
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	// Upload the whole frame once, the texture pitch may be wider than a row
+	void* texture_pixels;
+	int pitch;
+	if (SDL_LockTexture(this->frame_texture, NULL, &texture_pixels, &pitch) == 0) {
+		size_t row_size = this->frame_width * sizeof(uint32_t);
+		if (static_cast<size_t>(pitch) == row_size) {
+			memcpy(texture_pixels, pixels, row_size * this->frame_height);
+		} else {
+			for (int y = 0; y < this->frame_height; y++) {
+				memcpy(static_cast<uint8_t*>(texture_pixels) + y * pitch,
+					pixels + y * this->frame_width, row_size);
+			}
+		}
+		SDL_UnlockTexture(this->frame_texture);
+	}
+	SDL_RenderCopy(this->renderer, this->frame_texture, NULL, NULL);
+	Uint64 uploaded = SDL_GetPerformanceCounter();
+
+	SDL_RenderPresent(this->renderer);
+	Uint64 presented = SDL_GetPerformanceCounter();
+
+	this->updateStats(uploaded - start, presented - start);
+}
+
+double Graphics::getUploadTime() {
+	return this->upload_time;
+}
+
+double Graphics::getPresentTime() {
+	return this->present_time;
+}
+
+void Graphics::setOverlayText(std::string text) {
+	this->overlay_text = text;
+}
+
+void Graphics::updateStats(Uint64 upload, Uint64 present) {
+	this->upload_ticks += upload;
+	this->present_ticks += present;
+	this->stats_frames++;
+
+	Uint32 now = SDL_GetTicks();
+	if (now - this->stats_start < STATS_INTERVAL_MS) return;
+
+	// Average over the interval and show it in the window title
+	double ticks_to_ms = 1000.0 / SDL_GetPerformanceFrequency() / this->stats_frames;
+	this->upload_time = this->upload_ticks * ticks_to_ms;
+	this->present_time = this->present_ticks * ticks_to_ms;
+
+	char stats[256];
+	snprintf(stats, sizeof(stats), "%s | %u fps | upload %.3fms | present %.3fms | %s",
+		this->title.c_str(), this->stats_frames * 1000 / (now - this->stats_start),
+		this->upload_time, this->present_time, this->overlay_text.c_str());
+	SDL_SetWindowTitle(this->window, stats);
+
+	this->upload_ticks = 0;
+	this->present_ticks = 0;
+	this->stats_frames = 0;
+	this->stats_start = now;
 }
\ No newline at end of file
@@ -8,7 +8,7 @@
 
 class Graphics {
 public:
-	Graphics(std::string title, int window_width, int window_height);
+	Graphics(std::string title, int window_width, int window_height, bool vsync = true);
 	~Graphics();
 
 	void clear();
@@ -22,9 +22,36 @@ public:
 
 	SDL_Texture* loadImage(std::string file);
 	void render(SDL_Texture* source, SDL_Rect* source_rect, SDL_Rect* destination_rect);
+
+	// Whole frame presentation through a persistent streaming texture,
+	// pixels are ARGB8888 and width*height in size.
+	void createFrameTexture(int width, int height);
+	void presentFrame(const uint32_t* pixels);
+
+	// Average time (ms) spent uploading and presenting a frame over the
+	// last stats interval.
+	double getUploadTime();
+	double getPresentTime();
+
+	// Extra stats (e.g. filter times) appended to the window title
+	void setOverlayText(std::string text);
 private:
 	std::map<std::string, SDL_Texture*> sprite_sheets;
 
 	SDL_Window* window;
 	SDL_Renderer* renderer;
+
+	std::string title;
+	std::string overlay_text;
+
+	SDL_Texture* frame_texture;
+	int frame_width, frame_height;
+
+	// Frame timing stats, shown in the window title
+	Uint64 upload_ticks, present_ticks;
+	unsigned int stats_frames;
+	Uint32 stats_start;
+	double upload_time, present_time;
+
+	void updateStats(Uint64 upload, Uint64 present);
 };
\ No newline at end of file
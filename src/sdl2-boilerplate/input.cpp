@@ -1,8 +1,19 @@
 #include "input.h"
 
+#include <string.h>
+
+Input::Input() {
+	memset(this->heldKeys, 0, sizeof(this->heldKeys));
+	memset(this->releasedKeys, 0, sizeof(this->releasedKeys));
+	memset(this->pressedKeys, 0, sizeof(this->pressedKeys));
+	this->mouseX = 0;
+	this->mouseY = 0;
+}
+
 void Input::beginNewFrame() {
-	this->releasedKeys.clear();
-	this->heldKeys.clear();
+	// Held keys stay held until their key up event
+	memset(this->releasedKeys, 0, sizeof(this->releasedKeys));
+	memset(this->pressedKeys, 0, sizeof(this->pressedKeys));
 }
 
 void Input::pollEvents(SDL_Event &e) {
@@ -25,25 +36,32 @@ void Input::pollEvents(SDL_Event &e) {
 }
 
 void Input::keyUpEvent(SDL_Event &e) {
+	if (e.key.keysym.scancode >= SDL_NUM_SCANCODES) return;
 	this->releasedKeys[e.key.keysym.scancode] = true;
 	this->heldKeys[e.key.keysym.scancode] = false;
 }
 
 void Input::keyDownEvent(SDL_Event &e) {
+	this->lastKeyDown = std::chrono::steady_clock::now();
+	if (e.key.keysym.scancode >= SDL_NUM_SCANCODES) return;
 	this->pressedKeys[e.key.keysym.scancode] = true;
 	this->heldKeys[e.key.keysym.scancode] = true;
 }
 
 bool Input::wasKeyReleased(SDL_Scancode key) {
-	return this->releasedKeys[key];
+	return key < SDL_NUM_SCANCODES && this->releasedKeys[key];
 }
 
 bool Input::wasKeyHeld(SDL_Scancode key) {
-	return this->heldKeys[key];
+	return key < SDL_NUM_SCANCODES && this->heldKeys[key];
 }
 
 bool Input::wasKeyPressed(SDL_Scancode key) {
-	return this->pressedKeys[key];
+	return key < SDL_NUM_SCANCODES && this->pressedKeys[key];
+}
+
+std::chrono::steady_clock::time_point Input::getLastKeyDownTime() {
+	return this->lastKeyDown;
 }
 
 int Input::getMouseX() {
@@ -1,16 +1,21 @@
 #pragma once
 
 #include <SDL2/SDL.h>
-#include <map>
+#include <chrono>
 
 class Input {
 public:
+	Input();
+
 	void beginNewFrame();
 
 	bool wasKeyPressed(SDL_Scancode key);
 	bool wasKeyHeld(SDL_Scancode key);
 	bool wasKeyReleased(SDL_Scancode key);
 
+	// When the most recent key down event was handled
+	std::chrono::steady_clock::time_point getLastKeyDownTime();
+
 	int getMouseX();
 	int getMouseY();
 
@@ -19,9 +24,12 @@ public:
 
 	void pollEvents(SDL_Event& e);
 private:
-	std::map<SDL_Scancode, bool> heldKeys;
-	std::map<SDL_Scancode, bool> releasedKeys;
-	std::map<SDL_Scancode, bool> pressedKeys;
+	// Indexed by scancode, no lookups on the hot path
+	bool heldKeys[SDL_NUM_SCANCODES];
+	bool releasedKeys[SDL_NUM_SCANCODES];
+	bool pressedKeys[SDL_NUM_SCANCODES];
+
+	std::chrono::steady_clock::time_point lastKeyDown;
 
 	int mouseX, mouseY;
-};
\ No newline at end of file
+};
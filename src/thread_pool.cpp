@@ -0,0 +1,74 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned int threads) {
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+
+	job = NULL;
+	rows = slices = next_slice = finished_slices = 0;
+	generation = 0;
+	stopping = false;
+
+	// The caller is the first thread
+	for (unsigned int i = 1; i < threads; i++) workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_ready.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+unsigned int ThreadPool::getThreadCount() {
+	return workers.size() + 1;
+}
+
+void ThreadPool::runSlices(int rows, const std::function<void(int, int)>& job) {
+	if (workers.empty()) {
+		job(0, rows);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	this->job = &job;
+	this->rows = rows;
+	slices = getThreadCount();
+	next_slice = 0;
+	finished_slices = 0;
+	generation++;
+	work_ready.notify_all();
+
+	while (runNextSlice(lock));
+	work_done.wait(lock, [this] { return finished_slices == slices; });
+	this->job = NULL;
+}
+
+bool ThreadPool::runNextSlice(std::unique_lock<std::mutex>& lock) {
+	if (job == NULL || next_slice == slices) return false;
+
+	int slice = next_slice++;
+	int first_row = rows * slice / slices;
+	int end_row = rows * (slice + 1) / slices;
+	const std::function<void(int, int)>& current = *job;
+
+	lock.unlock();
+	current(first_row, end_row);
+	lock.lock();
+
+	if (++finished_slices == slices) work_done.notify_all();
+	return true;
+}
+
+void ThreadPool::workerLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	unsigned long seen = 0;
+	while (true) {
+		work_ready.wait(lock, [this, seen] { return stopping || generation != seen; });
+		if (stopping) return;
+		seen = generation;
+		while (runNextSlice(lock));
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Fixed set of worker threads for splitting per-frame work (filters) into
+horizontal slices. The calling thread works on slices too and
+runSlices() only returns once every slice is done.
+*/
+
+class ThreadPool {
+public:
+	// 0 threads means one per hardware thread
+	ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+
+	// Splits rows [0, rows) into slices and calls job(first_row, end_row)
+	// for each one across the pool.
+	void runSlices(int rows, const std::function<void(int, int)>& job);
+
+	unsigned int getThreadCount();
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable work_ready, work_done;
+
+	// Current job, guarded by mutex
+	const std::function<void(int, int)>* job;
+	int rows, slices, next_slice, finished_slices;
+	unsigned long generation;
+	bool stopping;
+
+	void workerLoop();
+	bool runNextSlice(std::unique_lock<std::mutex>& lock);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,109 @@
+#include "throughput.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	const double NTSC_FRAME_RATE = 60.0988;
+}
+
+Throughput::Throughput(NES& nes, CPU& cpu, Memory& memory) : nes(nes), cpu(cpu), memory(memory) {
+	movie = NULL;
+	counter_fd = -1;
+	memset(&warmup, 0, sizeof(warmup));
+	memset(&measured, 0, sizeof(measured));
+
+#ifdef __linux__
+	// User space instructions retired by this thread, needs
+	// perf_event_paranoid <= 2 which is the usual default.
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	counter_fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+}
+
+Throughput::~Throughput() {
+#ifdef __linux__
+	if (counter_fd >= 0) close(counter_fd);
+#endif
+}
+
+void Throughput::setMovie(const Movie* movie) {
+	this->movie = movie;
+}
+
+void Throughput::run(unsigned long warmup_frames, unsigned long frames) {
+	warmup = runPhase(warmup_frames);
+	measured = runPhase(frames);
+}
+
+Throughput::Phase Throughput::runPhase(unsigned long frames) {
+	Phase phase;
+	phase.frames = frames;
+	unsigned long long first_instruction = cpu.get_instruction_count();
+	long long first_count = readCounter();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (unsigned long i = 0; i < frames; i++) {
+		if (movie) {
+			unsigned long frame = nes.getFrameCount();
+			memory.getController(0).setButtons(movie->getButtons(frame, 0));
+			memory.getController(1).setButtons(movie->getButtons(frame, 1));
+		}
+		nes.run_frame(false);
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	long long last_count = readCounter();
+	phase.seconds = elapsed.count();
+	phase.guest_instructions = cpu.get_instruction_count() - first_instruction;
+	phase.host_instructions = first_count >= 0 && last_count >= 0 ? last_count - first_count : -1;
+	return phase;
+}
+
+long long Throughput::readCounter() {
+#ifdef __linux__
+	long long count;
+	if (counter_fd >= 0 && read(counter_fd, &count, sizeof(count)) == sizeof(count)) return count;
+#endif
+	return -1;
+}
+
+void Throughput::printPhase(const char* name, const Phase& phase) {
+	double seconds = phase.seconds > 0.0 ? phase.seconds : 1e-9;
+	printf("%s: %lu frames in %.3fs\n", name, phase.frames, phase.seconds);
+	printf("  Emulated FPS:          %.1f (%.1fx realtime)\n", phase.frames / seconds, phase.frames / seconds / NTSC_FRAME_RATE);
+	printf("  Guest instructions/s:  %.2fM\n", phase.guest_instructions / seconds / 1e6);
+	if (phase.host_instructions >= 0) {
+		printf("  Host instructions/s:   %.2fM (%.1f per guest instruction)\n", phase.host_instructions / seconds / 1e6,
+			phase.guest_instructions ? static_cast<double>(phase.host_instructions) / phase.guest_instructions : 0.0);
+	}
+	else {
+		printf("  Host instructions/s:   unavailable (no perf counters)\n");
+	}
+}
+
+void Throughput::report() {
+	printf("\n");
+	if (warmup.frames) printPhase("Warm-up", warmup);
+	printPhase("Measured", measured);
+
+	// ru_maxrss is in kilobytes on Linux
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("Peak RSS: %.1fMB\n", usage.ru_maxrss / 1024.0);
+}
@@ -0,0 +1,50 @@
+#ifndef THROUGHPUT_H
+#define THROUGHPUT_H
+
+#include "cpu.h"
+#include "memory.h"
+#include "nes.h"
+#include "movie.h"
+
+/*
+Whole system throughput for sizing batch machines. Runs a number of
+frames with no video, audio or logging, optionally replaying a movie,
+and reports emulated FPS, guest and host instructions per second and
+peak RSS. Warm-up frames (caches, branch predictors, page faults of a
+fresh process) are timed and reported on their own, everything before
+run() is left out.
+*/
+
+class Throughput {
+public:
+	Throughput(NES& nes, CPU& cpu, Memory& memory);
+	~Throughput();
+
+	// Input for both controllers, frame 0 is the first frame run
+	void setMovie(const Movie* movie);
+
+	void run(unsigned long warmup_frames, unsigned long frames);
+	void report();
+private:
+	struct Phase {
+		unsigned long frames;
+		double seconds;
+		unsigned long long guest_instructions;
+		long long host_instructions;	// -1 if the counter isn't available
+	};
+
+	NES& nes;
+	CPU& cpu;
+	Memory& memory;
+	const Movie* movie;
+
+	int counter_fd;	// perf_event_open() fd counting this thread's instructions
+	Phase warmup;
+	Phase measured;
+
+	Phase runPhase(unsigned long frames);
+	long long readCounter();
+	void printPhase(const char* name, const Phase& phase);
+};
+
+#endif // THROUGHPUT_H
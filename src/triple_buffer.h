@@ -0,0 +1,47 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+#include "definitions.h"
+
+/*
+Lock-free single producer/single consumer triple buffer. The producer
+always has a back buffer to write into, the consumer always has a
+front buffer to read from, and the middle one is swapped atomically
+between them. The consumer only ever sees the newest published value,
+older ones are silently dropped.
+*/
+
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() : back(0), middle(1), front(2) {}
+
+	// Producer side
+	T& getBack() { return buffers[back]; }
+	void publish() {
+		u8 previous = middle.exchange(back | DIRTY, std::memory_order_acq_rel);
+		back = previous & INDEX;
+	}
+
+	// Consumer side, returns true if a new value was swapped in
+	bool update() {
+		if (!(middle.load(std::memory_order_relaxed) & DIRTY)) return false;
+		u8 previous = middle.exchange(front, std::memory_order_acq_rel);
+		front = previous & INDEX;
+		return true;
+	}
+	const T& getFront() const { return buffers[front]; }
+
+private:
+	static const u8 INDEX = 0x03;
+	static const u8 DIRTY = 0x04;
+
+	T buffers[3];
+	u8 back;
+	std::atomic<u8> middle;
+	u8 front;
+};
+
+#endif // TRIPLE_BUFFER_H
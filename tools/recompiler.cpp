@@ -0,0 +1,433 @@
+/*
+Static recompiler for mapper 0 (NROM) games. Follows the code reachable
+from the NMI, reset and IRQ vectors, writes every subroutine out as a C++
+function that calls the CPU's own opcode handlers in sequence, and builds
+that into a shared object the emulator loads with --recompiled. Cycles,
+flags and memory accesses are exactly the interpreter's, what goes away is
+the fetch, decode and dispatch of every instruction and the per-tick
+bookkeeping between them.
+
+The interpreter stays in charge of everything else. Recompiled code hands
+control back on unofficial opcodes and BRK, on any access to the APU and
+IO registers (they are timed against the master clock, which only moves
+between ticks), on RTS and RTI to anywhere but the caller, indirect jumps,
+at the next event and while DMC stall cycles are owed (the interpreter
+charges them after the instruction that found them). Code that is only
+reached through jump tables (JMP indirect, pushed return addresses)
+isn't found and is interpreted.
+
+The shared object is built with the same NES_* options this tool was,
+so it sees the same classes as an emulator from the same make.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <deque>
+
+#include "../src/cartridge.h"
+#include "../src/opcodes.h"
+#include "../src/recompiled_library.h"
+
+#ifndef NES_SOURCE_DIR
+#define NES_SOURCE_DIR "src"
+#endif
+
+namespace {
+	// The emulator's build options, the generated code has to be compiled
+	// against the same class layouts
+	const char* const NES_DEFINES = ""
+#ifdef NES_PROFILER
+		" -DNES_PROFILER"
+#endif
+#ifdef NES_COVERAGE
+		" -DNES_COVERAGE"
+#endif
+#ifdef NES_DEBUGGER
+		" -DNES_DEBUGGER"
+#endif
+#ifdef NES_TABLE_ALU
+		" -DNES_TABLE_ALU"
+#endif
+		;
+
+	const u8 BRK = 0x00, JSR = 0x20, RTI = 0x40, JMP = 0x4C, RTS = 0x60, JMP_INDIRECT = 0x6C;
+
+	bool is_io_register(unsigned int address) {
+		return 0x4000 <= address && address <= 0x401F;
+	}
+
+	// Whether base plus any index register value can land on an IO register
+	bool may_index_into_io(u16 base) {
+		for (unsigned int index = 0; index <= 0xFF; index++) {
+			if (is_io_register(static_cast<u16>(base + index))) return true;
+		}
+		return false;
+	}
+
+	struct Instruction {
+		u16 address;
+		u8 opcode;
+		opcodes::AddressMode mode;
+		u16 operand;	// Byte or word after the opcode
+		u8 length;
+	};
+
+	class Recompiler {
+	public:
+		Recompiler(Cartridge& cartridge) : cartridge(cartridge) {}
+
+		void trace();
+		std::string generate(const std::string& rom);
+
+		unsigned long getFunctionCount() { return functions.size(); }
+		unsigned long getInstructionCount() { return compiled; }
+		unsigned long getInterpretedCount() { return interpreted.size(); }
+	private:
+		struct Function {
+			std::set<u16> instructions;	// Compiled, in address order
+		};
+
+		Cartridge& cartridge;
+		std::map<u16, Function> functions;
+		std::map<u16, u16> owners;	// Address to the function whose code runs there
+		std::set<u16> interpreted;	// Reached but left to the interpreter
+		unsigned long compiled = 0;
+
+		bool isCompiledEntry(u16 address) {
+			auto function = functions.find(address);
+			return function != functions.end() && function->second.instructions.count(address);
+		}
+		u8 readByte(unsigned int address) {
+			return cartridge.getPagePointer(address)[address & 0xFF];
+		}
+		bool decode(u16 address, Instruction& instruction);
+		bool compilable(const Instruction& instruction);
+		void traceFunction(u16 entry, std::deque<u16>& calls);
+		void generateFunction(std::string& out, u16 entry, const Function& function);
+		void generateInstruction(std::string& out, const Instruction& instruction, const Function& function, int next);
+	};
+
+	// False for unofficial opcodes, which have no handlers to call
+	bool Recompiler::decode(u16 address, Instruction& instruction) {
+		if (address < 0x8000) return false;
+		const opcodes::Info& op = opcodes::TABLE[readByte(address)];
+		instruction.address = address;
+		instruction.opcode = readByte(address);
+		instruction.mode = op.mode;
+		instruction.length = op.length;
+		if (!op.official || address + instruction.length > 0x10000) return false;
+		instruction.operand = 0;
+		if (instruction.length > 1) instruction.operand = readByte(address + 1);
+		if (instruction.length > 2) instruction.operand |= readByte(address + 2) << 8;
+		return true;
+	}
+
+	// Instructions whose outcome doesn't depend on where in the tick they run
+	bool Recompiler::compilable(const Instruction& instruction) {
+		if (instruction.opcode == BRK) return false;
+		if (instruction.mode == opcodes::ABS && instruction.opcode != JMP && instruction.opcode != JSR)
+			return !is_io_register(instruction.operand);
+		if (instruction.mode == opcodes::IND)
+			return !is_io_register(instruction.operand) && !is_io_register(instruction.operand + 1);
+		return true;
+	}
+
+	void Recompiler::trace() {
+		std::deque<u16> calls;
+		const u16 vectors[] = {0xFFFA, 0xFFFC, 0xFFFE};	// NMI, reset, IRQ
+		for (u16 vector : vectors) calls.push_back(readByte(vector) | readByte(vector + 1) << 8);
+
+		while (!calls.empty()) {
+			u16 entry = calls.front();
+			calls.pop_front();
+			if (entry >= 0x8000 && functions.find(entry) == functions.end()) traceFunction(entry, calls);
+		}
+
+		// Entry points run their own function, everything else the first
+		// function found running through it
+		for (auto& function : functions) {
+			if (function.second.instructions.count(function.first)) owners[function.first] = function.first;
+		}
+		for (auto& function : functions) {
+			for (u16 address : function.second.instructions) owners.insert(std::make_pair(address, function.first));
+			compiled += function.second.instructions.size();
+		}
+	}
+
+	// Everything reachable from entry without a JSR, RTS or RTI. Jumps and
+	// branches outside the subroutine are followed too, the code is
+	// duplicated rather than leaving the function.
+	void Recompiler::traceFunction(u16 entry, std::deque<u16>& calls) {
+		Function& function = functions[entry];
+		std::set<u16> visited;
+		std::deque<u16> pending(1, entry);
+		while (!pending.empty()) {
+			u16 address = pending.front();
+			pending.pop_front();
+			if (!visited.insert(address).second) continue;
+
+			// The interpreter runs unofficial opcodes as NOPs of their usual
+			// length for now, tracing carries on after them the same way
+			Instruction instruction;
+			if (!decode(address, instruction)) {
+				if (address < 0x8000) continue;
+				interpreted.insert(address);
+				if (!opcodes::TABLE[instruction.opcode].official) pending.push_back(address + instruction.length);
+				continue;
+			}
+			if (!compilable(instruction)) {
+				// The interpreter runs it, recompiled code picks up again after
+				interpreted.insert(address);
+				if (instruction.opcode != BRK) pending.push_back(address + instruction.length);
+				continue;
+			}
+			function.instructions.insert(address);
+
+			u16 next = address + instruction.length;
+			switch (instruction.opcode) {
+				case JSR:
+					calls.push_back(instruction.operand);
+					pending.push_back(next);
+					break;
+				case JMP:
+					pending.push_back(instruction.operand);
+					break;
+				case JMP_INDIRECT:
+				case RTS:
+				case RTI:
+					break;
+				default:
+					if (instruction.mode == opcodes::REL) pending.push_back(next + static_cast<s8>(instruction.operand));
+					pending.push_back(next);
+					break;
+			}
+		}
+	}
+
+	std::string label(u16 address) {
+		char name[16];
+		snprintf(name, sizeof(name), "L_%04X", address);
+		return name;
+	}
+
+	// Leaves the function unless target was compiled into it
+	std::string jump(u16 target, const std::set<u16>& instructions) {
+		return instructions.count(target) ? "goto " + label(target) + ";" : "return;";
+	}
+
+	std::string format(const char* format, unsigned int a, unsigned int b = 0) {
+		char text[256];
+		snprintf(text, sizeof(text), format, a, b);
+		return text;
+	}
+
+	/*
+	Every instruction starts with regPC at its own address, so returning
+	from anywhere before its handler leaves the CPU where the interpreter
+	expects it.
+	*/
+	void Recompiler::generateInstruction(std::string& out, const Instruction& instruction, const Function& function, int next) {
+		u16 address = instruction.address;
+		out += label(address) + ":\n";
+		out += "\tif (cpu.total_cycles + cpu.loop_cycles > cpu.next_event || cpu.memory.getAPU().hasStallCycles()) return;\n";
+
+		// Indexed and indirect accesses are only known at run time
+		switch (instruction.mode) {
+			case opcodes::ABX:
+				if (may_index_into_io(instruction.operand))
+					out += format("\tif (is_io_register(static_cast<u16>(0x%04X + cpu.regX.value()))) return;\n", instruction.operand);
+				break;
+			case opcodes::ABY:
+				if (may_index_into_io(instruction.operand))
+					out += format("\tif (is_io_register(static_cast<u16>(0x%04X + cpu.regY.value()))) return;\n", instruction.operand);
+				break;
+			case opcodes::IZX:
+				out += format("\tif (is_io_register(pre_indexed_indirect(cpu, 0x%02X))) return;\n", instruction.operand);
+				break;
+			case opcodes::IZY:
+				out += format("\tif (is_io_register(post_indexed_indirect(cpu, 0x%02X))) return;\n", instruction.operand);
+				break;
+			default:
+				break;
+		}
+
+		out += "\tcpu.instructions++;\n";
+		out += format("\tcpu.regPC.set(0x%04X);\n", address + 1);
+		out += "\tcpu." + std::string(opcodes::TABLE[instruction.opcode].mnemonic) + format("_%02X();\n", instruction.opcode);
+
+		u16 fallthrough = address + instruction.length;
+		switch (instruction.opcode) {
+			case JMP:
+				out += "\t" + jump(instruction.operand, function.instructions) + "\n";
+				return;
+			case JSR:
+				// Calls straight into the subroutine, which returns here when
+				// it runs its RTS or hands over to the interpreter. Only an
+				// RTS to the usual place carries on in this function.
+				if (isCompiledEntry(instruction.operand)) {
+					out += format("\tRecompiled::run_%04X(cpu);\n", instruction.operand);
+					out += format("\tif (cpu.regPC.value() != 0x%04X) return;\n", fallthrough);
+					break;
+				}
+				out += "\treturn;\n";
+				return;
+			case JMP_INDIRECT:
+			case RTS:
+			case RTI:
+				out += "\treturn;\n";
+				return;
+			default:
+				break;
+		}
+		if (instruction.mode == opcodes::REL) {
+			u16 target = fallthrough + static_cast<s8>(instruction.operand);
+			out += format("\tif (cpu.regPC.value() != 0x%04X) ", fallthrough) + jump(target, function.instructions) + "\n";
+		}
+		if (next != fallthrough) out += "\t" + jump(fallthrough, function.instructions) + "\n";
+	}
+
+	void Recompiler::generateFunction(std::string& out, u16 entry, const Function& function) {
+		out += format("void Recompiled::run_%04X(CPU& cpu) {\n", entry);
+		out += "\tswitch (cpu.regPC.value()) {\n";
+		for (u16 address : function.instructions) {
+			if (owners[address] == entry) out += format("\t\tcase 0x%04X: goto L_%04X;\n", address, address);
+		}
+		out += "\t\tdefault: return;\n";
+		out += "\t}\n\n";
+
+		for (auto it = function.instructions.begin(); it != function.instructions.end(); ++it) {
+			auto following = std::next(it);
+			int next = following == function.instructions.end() ? -1 : *following;
+			Instruction instruction;
+			decode(*it, instruction);
+			generateInstruction(out, instruction, function, next);
+		}
+		out += "}\n\n";
+	}
+
+	std::string Recompiler::generate(const std::string& rom) {
+		std::string out;
+		out += "// Recompiled from " + rom + " by nes-recompile, don't edit\n\n";
+		out += "#include \"cpu.h\"\n";
+		out += "#include \"recompiled_library.h\"\n\n";
+		out += "namespace {\n";
+		out += "\tinline bool is_io_register(u16 address) {\n";
+		out += "\t\treturn 0x4000 <= address && address <= 0x401F;\n";
+		out += "\t}\n\n";
+		out += "\t// Same effective addresses as CPU::pre_indexed_indirect() and\n";
+		out += "\t// CPU::post_indexed_indirect(), the pointers are always in RAM\n";
+		out += "\tinline u16 read_pointer(CPU& cpu, u16 low_address, u16 high_address) {\n";
+		out += "\t\tu8 low, high;\n";
+		out += "\t\tcpu.memory.peekByte(low_address, low);\n";
+		out += "\t\tcpu.memory.peekByte(high_address, high);\n";
+		out += "\t\treturn static_cast<u16>(high << 8 | low);\n";
+		out += "\t}\n\n";
+		out += "\tinline u16 pre_indexed_indirect(CPU& cpu, u8 operand) {\n";
+		out += "\t\tu8 pointer = operand + cpu.regX.value();\n";
+		out += "\t\treturn read_pointer(cpu, pointer, static_cast<u8>(pointer + 1));\n";
+		out += "\t}\n\n";
+		out += "\tinline u16 post_indexed_indirect(CPU& cpu, u8 operand) {\n";
+		out += "\t\treturn static_cast<u16>(read_pointer(cpu, operand, operand + 1) + cpu.regY.value());\n";
+		out += "\t}\n";
+		out += "}\n\n";
+
+		out += "struct Recompiled {\n";
+		for (auto& function : functions) out += format("\tstatic void run_%04X(CPU& cpu);\n", function.first);
+		out += "};\n\n";
+
+		for (auto& function : functions) generateFunction(out, function.first, function.second);
+
+		out += "extern \"C\" const recompiled::Entry nes_recompiled_entries[] = {\n";
+		for (auto& owner : owners) out += format("\t{0x%04X, Recompiled::run_%04X},\n", owner.first, owner.second);
+		out += "};\n";
+		out += format("extern \"C\" const unsigned int nes_recompiled_entry_count = %u;\n", owners.size());
+		unsigned long long hash = recompiled::hashPRG(cartridge);
+		out += format("extern \"C\" const u64 nes_recompiled_prg_hash = 0x%08X", hash >> 32) + format("%08XULL;\n", hash & 0xFFFFFFFF);
+		out += format("extern \"C\" const unsigned int nes_recompiled_format_version = %u;\n", recompiled::FORMAT_VERSION);
+		out += "extern \"C\" const unsigned int nes_recompiled_cpu_size = sizeof(CPU);\n";
+		out += "extern \"C\" const unsigned int nes_recompiled_memory_size = sizeof(Memory);\n";
+		out += "extern \"C\" const unsigned int nes_recompiled_apu_size = sizeof(APU);\n";
+		out += "extern \"C\" const unsigned int nes_recompiled_cartridge_size = sizeof(Cartridge);\n";
+		return out;
+	}
+
+	void usage() {
+		printf("Usage: nes-recompile [options] <rom.nes>\n");
+		printf("  -o <file>              Shared object to build (default <rom>.so)\n");
+		printf("  --cpp <file>           Where the generated C++ goes (default <output>.cpp)\n");
+		printf("  --no-build             Only write the C++\n");
+		printf("  --cxx <compiler>       Compiler for the shared object (default $CXX or c++)\n");
+		printf("  --cxxflags <flags>     Extra flags for it (default -O2), the emulator's\n");
+		printf("                         NES_* options are passed on already\n");
+		printf("  --include <dir>        The emulator's src directory (default %s)\n", NES_SOURCE_DIR);
+	}
+}
+
+int main(int argc, char **argv) {
+	const char* rom = NULL;
+	std::string output;
+	std::string cpp;
+	bool build = true;
+	std::string cxx = getenv("CXX") ? getenv("CXX") : "c++";
+	std::string cxxflags = "-O2";
+	std::string include = NES_SOURCE_DIR;
+
+	for (int i = 1; i < argc; i++) {
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "-o") == 0 && has_value) output = argv[++i];
+		else if (strcmp(argv[i], "--cpp") == 0 && has_value) cpp = argv[++i];
+		else if (strcmp(argv[i], "--no-build") == 0) build = false;
+		else if (strcmp(argv[i], "--cxx") == 0 && has_value) cxx = argv[++i];
+		else if (strcmp(argv[i], "--cxxflags") == 0 && has_value) cxxflags = argv[++i];
+		else if (strcmp(argv[i], "--include") == 0 && has_value) include = argv[++i];
+		else if (argv[i][0] != '-' && rom == NULL) rom = argv[i];
+		else {
+			usage();
+			return -1;
+		}
+	}
+	if (rom == NULL) {
+		usage();
+		return -1;
+	}
+	if (output.empty()) output = std::string(rom) + ".so";
+	if (cpp.empty()) cpp = output + ".cpp";
+
+	Cartridge cartridge(rom);
+	if (cartridge.getMapperNumber() != 0) {
+		printf("ERROR: Only mapper 0 games can be recompiled, %s uses mapper %u!\n", rom, cartridge.getMapperNumber());
+		return -1;
+	}
+
+	Recompiler recompiler(cartridge);
+	recompiler.trace();
+	std::string code = recompiler.generate(rom);
+
+	FILE* file = fopen(cpp.c_str(), "w");
+	if (file == NULL) {
+		printf("ERROR: Unable to write %s!\n", cpp.c_str());
+		return -1;
+	}
+	fwrite(code.data(), 1, code.size(), file);
+	fclose(file);
+	printf("%lu subroutines, %lu instructions recompiled, %lu left to the interpreter\n",
+		recompiler.getFunctionCount(), recompiler.getInstructionCount(), recompiler.getInterpretedCount());
+	printf("Wrote %s\n", cpp.c_str());
+	if (!build) return 0;
+
+	// Labels are emitted for every instruction, most are never jumped to
+	std::string command = cxx + " -std=c++14 -shared -fPIC -Wno-unused-label" + NES_DEFINES + " " + cxxflags +
+		" -I" + include + " " + cpp + " -o " + output;
+	printf("%s\n", command.c_str());
+	if (system(command.c_str()) != 0) {
+		printf("ERROR: Building %s failed!\n", output.c_str());
+		return -1;
+	}
+	printf("Wrote %s\n", output.c_str());
+	return 0;
+}